@@ -0,0 +1,305 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include <mgpp/ao.hpp>
+
+enum BenchSignal {
+  LEAF_SIG = mgpp::ao::USER_SIG,  // handled by the leaf state
+  ROOT_SIG,                       // handled by the outermost user state
+  UNHANDLED_SIG,                  // handled by no state
+  TOGGLE_SIG                      // transition between the two leaves
+};
+
+constexpr int kMaxDepth = 16;
+
+// HSM with two chains of nested states, Left<1>..Left<depth> and
+// Right<1>..Right<depth>, whose only common ancestor is Top. The active leaf
+// is Left<depth> or Right<depth>, so every event dispatched to it and every
+// transition between the two leaves crosses `depth` levels of hierarchy.
+class DepthHsm : public mgpp::ao::Hsm {
+ public:
+  explicit DepthHsm(int depth);
+
+  template <int N>
+  static mgpp::ao::StateAction Left(DepthHsm *const me,
+                                    const mgpp::ao::EventConstPtr &evt) {
+    if (mgpp::ao::StateCast(Left<N>) == me->left_leaf_) {
+      switch (evt->id()) {
+        case LEAF_SIG:
+          return me->Handled();
+        case TOGGLE_SIG:
+          return me->Transition<mgpp::ao::StateHandler>(me->right_leaf_);
+      }
+    }
+    if (N == 1 && evt->id() == ROOT_SIG) {
+      return me->Handled();
+    }
+    if (N == 1 && evt->id() == mgpp::ao::INIT_SIG &&
+        me->left_leaf_ != mgpp::ao::StateCast(Left<N>)) {
+      // Drill down from the outermost state to the leaf
+      return me->InitialTransition<mgpp::ao::StateHandler>(me->left_leaf_);
+    }
+
+    return me->Super<mgpp::ao::StateHandler>(
+        N == 1 ? mgpp::ao::StateCast(Top)
+               : mgpp::ao::StateCast(Left<(N > 1 ? N - 1 : 1)>));
+  }
+
+  template <int N>
+  static mgpp::ao::StateAction Right(DepthHsm *const me,
+                                     const mgpp::ao::EventConstPtr &evt) {
+    if (mgpp::ao::StateCast(Right<N>) == me->right_leaf_) {
+      switch (evt->id()) {
+        case LEAF_SIG:
+          return me->Handled();
+        case TOGGLE_SIG:
+          return me->Transition<mgpp::ao::StateHandler>(me->left_leaf_);
+      }
+    }
+    if (N == 1 && evt->id() == ROOT_SIG) {
+      return me->Handled();
+    }
+
+    return me->Super<mgpp::ao::StateHandler>(
+        N == 1 ? mgpp::ao::StateCast(Top)
+               : mgpp::ao::StateCast(Right<(N > 1 ? N - 1 : 1)>));
+  }
+
+ private:
+  mgpp::ao::StateHandler left_leaf_;
+  mgpp::ao::StateHandler right_leaf_;
+};
+
+// Resolve the leaf states of a DepthHsm for a depth only known at runtime
+template <int N>
+struct Leaves {
+  static void Find(int depth, mgpp::ao::StateHandler *left,
+                   mgpp::ao::StateHandler *right) {
+    if (depth == N) {
+      *left = mgpp::ao::StateCast(DepthHsm::Left<N>);
+      *right = mgpp::ao::StateCast(DepthHsm::Right<N>);
+    } else {
+      Leaves<N - 1>::Find(depth, left, right);
+    }
+  }
+};
+
+template <>
+struct Leaves<0> {
+  static void Find(int depth, mgpp::ao::StateHandler *left,
+                   mgpp::ao::StateHandler *right) {
+    (void)depth;
+    *left = nullptr;
+    *right = nullptr;
+  }
+};
+
+DepthHsm::DepthHsm(int depth)
+    : mgpp::ao::Hsm(mgpp::ao::StateCast(Left<1>)),
+      left_leaf_(nullptr),
+      right_leaf_(nullptr) {
+  Leaves<kMaxDepth>::Find(depth, &left_leaf_, &right_leaf_);
+}
+
+static void DispatchSignal(benchmark::State &state, int sig,
+                           bool table = false) {
+  DepthHsm hsm(static_cast<int>(state.range(0)));
+  if (table) {
+    hsm.EnableDispatchTable();
+  }
+  hsm.Init();
+
+  mgpp::ao::EventConstPtr evt(mgpp::ao::MakeEvent<mgpp::ao::Event>(sig));
+  for (auto _ : state) {
+    hsm.Dispatch(evt);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// Event handled by the active leaf state
+static void BM_HsmDispatchLeaf(benchmark::State &state) {
+  DispatchSignal(state, LEAF_SIG);
+}
+BENCHMARK(BM_HsmDispatchLeaf)->DenseRange(1, kMaxDepth);
+
+// Event bubbled up from the leaf to the outermost user state
+static void BM_HsmDispatchRoot(benchmark::State &state) {
+  DispatchSignal(state, ROOT_SIG);
+}
+BENCHMARK(BM_HsmDispatchRoot)->DenseRange(1, kMaxDepth);
+
+// Event bubbled up to Top and ignored
+static void BM_HsmDispatchUnhandled(benchmark::State &state) {
+  DispatchSignal(state, UNHANDLED_SIG);
+}
+BENCHMARK(BM_HsmDispatchUnhandled)->DenseRange(1, kMaxDepth);
+
+// Transition between leaves, exiting and entering `depth` states each
+static void BM_HsmTransition(benchmark::State &state) {
+  DispatchSignal(state, TOGGLE_SIG);
+}
+BENCHMARK(BM_HsmTransition)->DenseRange(1, kMaxDepth);
+
+// Transitions dispatched 256 at a time
+static void BM_HsmTransitionBatch(benchmark::State &state) {
+  DepthHsm hsm(static_cast<int>(state.range(0)));
+  hsm.Init();
+
+  std::vector<mgpp::ao::EventConstPtr> events(
+      256, mgpp::ao::MakeEvent<mgpp::ao::Event>(TOGGLE_SIG));
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(hsm.DispatchBatch(events.data(), events.size()));
+  }
+  state.SetItemsProcessed(state.iterations() * events.size());
+}
+BENCHMARK(BM_HsmTransitionBatch)->Arg(1)->Arg(4)->Arg(8)->Arg(16);
+
+// Root and unhandled events looked up in the dispatch table
+static void BM_HsmTableDispatchRoot(benchmark::State &state) {
+  DispatchSignal(state, ROOT_SIG, true);
+}
+BENCHMARK(BM_HsmTableDispatchRoot)->DenseRange(1, kMaxDepth);
+
+static void BM_HsmTableDispatchUnhandled(benchmark::State &state) {
+  DispatchSignal(state, UNHANDLED_SIG, true);
+}
+BENCHMARK(BM_HsmTableDispatchUnhandled)->DenseRange(1, kMaxDepth);
+
+// Construction and initial transition into a leaf `depth` levels deep
+static void BM_HsmConstruct(benchmark::State &state) {
+  for (auto _ : state) {
+    DepthHsm hsm(static_cast<int>(state.range(0)));
+    hsm.Init();
+    benchmark::DoNotOptimize(hsm.state());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_HsmConstruct)->Arg(1)->Arg(kMaxDepth);
+
+// StaticHsm with the same shape as DepthHsm, for a depth fixed at compile
+// time. SLeft<Depth, N> and SRight<Depth, N> are the states at level N.
+template <int Depth, int N>
+struct SLeft;
+
+template <int Depth, int N>
+struct SRight;
+
+template <template <int, int> class Side, int Depth, int N>
+struct SideParent {
+  typedef Side<Depth, N - 1> type;
+};
+
+template <template <int, int> class Side, int Depth>
+struct SideParent<Side, Depth, 1> {
+  typedef mgpp::ao::TopState type;
+};
+
+template <template <int, int> class Side, template <int, int> class Other,
+          int Depth, int N>
+struct SideState
+    : mgpp::ao::StaticState<Side<Depth, N>,
+                            typename SideParent<Side, Depth, N>::type> {
+  template <class Machine>
+  static mgpp::ao::StateAction Handle(Machine &me,
+                                      const mgpp::ao::EventConstPtr &evt) {
+    if (N == Depth) {
+      switch (evt->id()) {
+        case LEAF_SIG:
+          return mgpp::ao::ACTION_HANDLED;
+        case TOGGLE_SIG:
+          return SideState::template TransitionTo<Other<Depth, Depth>>(me);
+      }
+    }
+    if (N == 1 && evt->id() == ROOT_SIG) {
+      return mgpp::ao::ACTION_HANDLED;
+    }
+    return mgpp::ao::ACTION_SUPER;
+  }
+};
+
+template <int Depth, int N>
+struct SLeft : SideState<SLeft, SRight, Depth, N> {};
+
+template <int Depth, int N>
+struct SRight : SideState<SRight, SLeft, Depth, N> {};
+
+template <int Depth>
+class StaticDepthHsm
+    : public mgpp::ao::StaticHsm<StaticDepthHsm<Depth>, SLeft<Depth, Depth>> {
+};
+
+template <int Depth>
+static void StaticDispatchSignal(benchmark::State &state, int sig) {
+  StaticDepthHsm<Depth> hsm;
+  hsm.Init();
+
+  mgpp::ao::EventConstPtr evt(mgpp::ao::MakeEvent<mgpp::ao::Event>(sig));
+  for (auto _ : state) {
+    hsm.Dispatch(evt);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+// The four cases above with the hierarchy resolved at compile time
+template <int Depth>
+static void BM_StaticHsmDispatchLeaf(benchmark::State &state) {
+  StaticDispatchSignal<Depth>(state, LEAF_SIG);
+}
+BENCHMARK_TEMPLATE(BM_StaticHsmDispatchLeaf, 1);
+BENCHMARK_TEMPLATE(BM_StaticHsmDispatchLeaf, 4);
+BENCHMARK_TEMPLATE(BM_StaticHsmDispatchLeaf, 8);
+BENCHMARK_TEMPLATE(BM_StaticHsmDispatchLeaf, 16);
+
+template <int Depth>
+static void BM_StaticHsmDispatchRoot(benchmark::State &state) {
+  StaticDispatchSignal<Depth>(state, ROOT_SIG);
+}
+BENCHMARK_TEMPLATE(BM_StaticHsmDispatchRoot, 1);
+BENCHMARK_TEMPLATE(BM_StaticHsmDispatchRoot, 4);
+BENCHMARK_TEMPLATE(BM_StaticHsmDispatchRoot, 8);
+BENCHMARK_TEMPLATE(BM_StaticHsmDispatchRoot, 16);
+
+template <int Depth>
+static void BM_StaticHsmDispatchUnhandled(benchmark::State &state) {
+  StaticDispatchSignal<Depth>(state, UNHANDLED_SIG);
+}
+BENCHMARK_TEMPLATE(BM_StaticHsmDispatchUnhandled, 1);
+BENCHMARK_TEMPLATE(BM_StaticHsmDispatchUnhandled, 4);
+BENCHMARK_TEMPLATE(BM_StaticHsmDispatchUnhandled, 8);
+BENCHMARK_TEMPLATE(BM_StaticHsmDispatchUnhandled, 16);
+
+template <int Depth>
+static void BM_StaticHsmTransition(benchmark::State &state) {
+  StaticDispatchSignal<Depth>(state, TOGGLE_SIG);
+}
+BENCHMARK_TEMPLATE(BM_StaticHsmTransition, 1);
+BENCHMARK_TEMPLATE(BM_StaticHsmTransition, 4);
+BENCHMARK_TEMPLATE(BM_StaticHsmTransition, 8);
+BENCHMARK_TEMPLATE(BM_StaticHsmTransition, 16);
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <mgpp/ao.hpp>
+
+enum BenchSignal { COUNT_SIG = mgpp::ao::USER_SIG };
+
+// Events posted to each machine per benchmark iteration
+constexpr int kEventsPerMachine = 8;
+
+// Flat HSM that only counts the events it handles
+class CountingHsm : public mgpp::ao::Hsm {
+ public:
+  explicit CountingHsm(std::atomic<std::int64_t> *handled)
+      : mgpp::ao::Hsm(mgpp::ao::StateCast(Initial)), handled_(handled) {}
+
+  static mgpp::ao::StateAction Initial(CountingHsm *const me,
+                                       const mgpp::ao::EventConstPtr &evt) {
+    (void)evt;
+    return me->InitialTransition(Running);
+  }
+
+  static mgpp::ao::StateAction Running(CountingHsm *const me,
+                                       const mgpp::ao::EventConstPtr &evt) {
+    switch (evt->id()) {
+      case COUNT_SIG:
+        me->handled_->fetch_add(1, std::memory_order_relaxed);
+        return me->Handled();
+      case mgpp::ao::SUPER_SIG:
+        return me->Super(Top);
+    }
+    return me->Handled();
+  }
+
+ private:
+  std::atomic<std::int64_t> *handled_;
+};
+
+// Events/s through state.range(0) machines sharing a scheduler with
+// state.range(1) workers. Each iteration posts kEventsPerMachine events to
+// every machine and waits for all of them to be dispatched.
+static void BM_SchedulerThroughput(benchmark::State &state) {
+  const int machines = static_cast<int>(state.range(0));
+  std::atomic<std::int64_t> handled(0);
+
+  mgpp::ao::Scheduler scheduler(static_cast<std::size_t>(state.range(1)));
+  std::vector<std::unique_ptr<mgpp::ao::Active>> actives;
+  for (int i = 0; i < machines; ++i) {
+    actives.emplace_back(new mgpp::ao::Active(
+        std::unique_ptr<mgpp::ao::Hsm>(new CountingHsm(&handled)),
+        kEventsPerMachine, &scheduler));
+    actives.back()->Start();
+  }
+
+  mgpp::ao::EventConstPtr evt(
+      mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(COUNT_SIG)));
+  std::int64_t expected = 0;
+  for (auto _ : state) {
+    for (int i = 0; i < kEventsPerMachine; ++i) {
+      for (auto &active : actives) {
+        active->Post(evt);
+      }
+    }
+    expected += static_cast<std::int64_t>(machines) * kEventsPerMachine;
+    while (handled.load(std::memory_order_relaxed) < expected) {
+      std::this_thread::yield();
+    }
+  }
+  state.SetItemsProcessed(expected);
+
+  actives.clear();
+}
+BENCHMARK(BM_SchedulerThroughput)
+    ->ArgsProduct({{16, 256, 4096, 20000}, {1, 2, 4, 8}})
+    ->UseRealTime();
+
+// The same load with a thread per machine, for comparison
+static void BM_ThreadPerMachineThroughput(benchmark::State &state) {
+  const int machines = static_cast<int>(state.range(0));
+  std::atomic<std::int64_t> handled(0);
+
+  std::vector<std::unique_ptr<mgpp::ao::Active>> actives;
+  for (int i = 0; i < machines; ++i) {
+    actives.emplace_back(new mgpp::ao::Active(
+        std::unique_ptr<mgpp::ao::Hsm>(new CountingHsm(&handled)),
+        kEventsPerMachine));
+    actives.back()->Start();
+  }
+
+  mgpp::ao::EventConstPtr evt(
+      mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(COUNT_SIG)));
+  std::int64_t expected = 0;
+  for (auto _ : state) {
+    for (int i = 0; i < kEventsPerMachine; ++i) {
+      for (auto &active : actives) {
+        active->Post(evt);
+      }
+    }
+    expected += static_cast<std::int64_t>(machines) * kEventsPerMachine;
+    while (handled.load(std::memory_order_relaxed) < expected) {
+      std::this_thread::yield();
+    }
+  }
+  state.SetItemsProcessed(expected);
+
+  actives.clear();
+}
+BENCHMARK(BM_ThreadPerMachineThroughput)->Arg(16)->Arg(256)->UseRealTime();
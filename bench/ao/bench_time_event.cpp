@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <vector>
+
+#include <mgpp/ao.hpp>
+
+// Wheel with `count` time events armed far enough out never to expire
+class ArmedWheel {
+ public:
+  explicit ArmedWheel(int count) {
+    events_.reserve(count);
+    for (int i = 0; i < count; ++i) {
+      events_.emplace_back(new mgpp::ao::TimeEvent(0, nullptr, &wheel_));
+      events_.back()->Arm((std::uint64_t(1) << 40) + i * 97);
+    }
+  }
+
+  mgpp::ao::TimerWheel wheel_;
+  std::vector<std::unique_ptr<mgpp::ao::TimeEvent>> events_;
+};
+
+// Arming and disarming one more time event
+static void BM_TimeEventArmDisarm(benchmark::State &state) {
+  ArmedWheel armed(static_cast<int>(state.range(0)));
+  mgpp::ao::TimeEvent event(0, nullptr, &armed.wheel_);
+
+  std::uint64_t ticks = 1;
+  for (auto _ : state) {
+    event.Arm(ticks);
+    event.Disarm();
+    ticks = ticks * 7 % 100003;
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimeEventArmDisarm)->Arg(0)->Arg(1000)->Arg(1000000);
+
+// Ticks in which nothing expires, including the cascades of outer levels
+static void BM_TimerWheelTick(benchmark::State &state) {
+  ArmedWheel armed(static_cast<int>(state.range(0)));
+
+  for (auto _ : state) {
+    armed.wheel_.Tick();
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_TimerWheelTick)->Arg(0)->Arg(1000)->Arg(1000000);
@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <vector>
+
+#include <mgpp/ao.hpp>
+
+enum TraceBenchSignal { LEAF_SIG = mgpp::ao::USER_SIG, TOGGLE_SIG };
+
+// Cost of one trace record, including its share of draining the buffer
+static void BM_TraceEvent(benchmark::State &state) {
+  std::vector<mgpp::ao::TraceRecord> drained(MGPP_AO_TRACE_BUFFER);
+  int signal = 0;
+  for (auto _ : state) {
+    mgpp::ao::TraceEvent(mgpp::ao::TRACE_DISPATCH, &drained, nullptr,
+                         signal);
+    if (++signal == MGPP_AO_TRACE_BUFFER) {
+      mgpp::ao::DrainTrace(drained.data(), drained.size());
+      signal = 0;
+    }
+  }
+  mgpp::ao::DrainTrace(drained.data(), drained.size());
+}
+BENCHMARK(BM_TraceEvent);
+
+// Two sibling leaves under one parent, toggled between by TOGGLE_SIG
+class ToggleHsm : public mgpp::ao::Hsm {
+ public:
+  ToggleHsm() : mgpp::ao::Hsm(mgpp::ao::StateCast(A)) {}
+
+  static mgpp::ao::StateAction Parent(ToggleHsm *const me,
+                                      const mgpp::ao::EventConstPtr &evt) {
+    switch (evt->id()) {
+      case mgpp::ao::ENTRY_SIG:
+      case mgpp::ao::EXIT_SIG:
+        return me->Handled();
+    }
+    return me->Super(mgpp::ao::Hsm::Top);
+  }
+
+  static mgpp::ao::StateAction A(ToggleHsm *const me,
+                                 const mgpp::ao::EventConstPtr &evt) {
+    switch (evt->id()) {
+      case mgpp::ao::ENTRY_SIG:
+      case mgpp::ao::EXIT_SIG:
+      case LEAF_SIG:
+        return me->Handled();
+      case TOGGLE_SIG:
+        return me->Transition(B);
+    }
+    return me->Super(Parent);
+  }
+
+  static mgpp::ao::StateAction B(ToggleHsm *const me,
+                                 const mgpp::ao::EventConstPtr &evt) {
+    switch (evt->id()) {
+      case mgpp::ao::ENTRY_SIG:
+      case mgpp::ao::EXIT_SIG:
+      case LEAF_SIG:
+        return me->Handled();
+      case TOGGLE_SIG:
+        return me->Transition(A);
+    }
+    return me->Super(Parent);
+  }
+};
+
+// This file is built twice: bench-trace compiles Hsm in with MGPP_AO_TRACE
+// and bench-trace-off links the untraced libao, so the two runs of the
+// benchmarks below give what tracing adds to Dispatch and Transition. Both
+// drain the buffers as a consumer would, keeping the traced run off the
+// cheaper path of dropping records into a full buffer.
+static void DispatchSignal(benchmark::State &state, int sig) {
+  const int kDrainEvery = 256;
+  std::vector<mgpp::ao::TraceRecord> drained(MGPP_AO_TRACE_BUFFER);
+  ToggleHsm hsm;
+  hsm.Init();
+  mgpp::ao::DrainTrace(drained.data(), drained.size());
+
+  mgpp::ao::EventConstPtr evt(mgpp::ao::MakeEvent<mgpp::ao::Event>(sig));
+  int dispatched = 0;
+  for (auto _ : state) {
+    hsm.Dispatch(evt);
+    if (++dispatched == kDrainEvery) {
+      mgpp::ao::DrainTrace(drained.data(), drained.size());
+      dispatched = 0;
+    }
+  }
+  mgpp::ao::DrainTrace(drained.data(), drained.size());
+  state.SetItemsProcessed(state.iterations());
+#ifdef MGPP_AO_TRACE
+  state.SetLabel("traced");
+#else
+  state.SetLabel("untraced");
+#endif
+}
+
+// Event handled by the active leaf, one record when traced
+static void BM_HsmDispatch(benchmark::State &state) {
+  DispatchSignal(state, LEAF_SIG);
+}
+BENCHMARK(BM_HsmDispatch);
+
+// Transition between the leaves, four records when traced
+static void BM_HsmTransition(benchmark::State &state) {
+  DispatchSignal(state, TOGGLE_SIG);
+}
+BENCHMARK(BM_HsmTransition);
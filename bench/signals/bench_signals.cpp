@@ -0,0 +1,353 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <benchmark/benchmark.h>
+
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include <boost/signals2.hpp>
+#include <mgpp/signals.hpp>
+
+// Stride between subscribed ids in the sparse id space benchmarks
+constexpr int kSparseIdStride = 7919;
+
+void NoopCb(const mgpp::signals::EventConstPtr &event) {
+  benchmark::DoNotOptimize(event.get());
+}
+
+// Cost of publishing one event to an id with state.range(0) subscribers
+static void BM_PublishFanout(benchmark::State &state) {
+  const int subscribers = static_cast<int>(state.range(0));
+  for (int i = 0; i < subscribers; ++i) {
+    mgpp::signals::Subscribe(0, &NoopCb);
+  }
+
+  mgpp::signals::EventConstPtr evt(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(0));
+  for (auto _ : state) {
+    mgpp::signals::Publish(evt);
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  mgpp::signals::UnsubscribeAll();
+}
+BENCHMARK(BM_PublishFanout)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+// Cost of publishing round-robin across state.range(0) subscribed ids, each
+// with one subscriber. state.range(1) selects a dense (0) or sparse (1) id
+// space.
+static void BM_PublishIdSpace(benchmark::State &state) {
+  const int ids = static_cast<int>(state.range(0));
+  const int stride = state.range(1) ? kSparseIdStride : 1;
+
+  std::vector<mgpp::signals::EventConstPtr> events;
+  for (int i = 0; i < ids; ++i) {
+    const int id = i * stride;
+    mgpp::signals::Subscribe(id, &NoopCb);
+    events.push_back(mgpp::signals::MakeEvent<mgpp::signals::Event>(id));
+  }
+
+  std::size_t next = 0;
+  for (auto _ : state) {
+    mgpp::signals::Publish(events[next]);
+    if (++next == events.size()) {
+      next = 0;
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  mgpp::signals::UnsubscribeAll();
+}
+BENCHMARK(BM_PublishIdSpace)
+    ->ArgNames({"ids", "sparse"})
+    ->ArgsProduct({{16, 256, 4096}, {0, 1}});
+
+// Cost of publishing an event nobody subscribed to
+static void BM_PublishNoSubscribers(benchmark::State &state) {
+  mgpp::signals::EventConstPtr evt(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(0));
+  for (auto _ : state) {
+    mgpp::signals::Publish(evt);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PublishNoSubscribers);
+
+// Cost of delivering one event to state.range(0) subscribers that each
+// want it under a different topic, emulated by publishing it once per id
+static void BM_PublishTopicEmulated(benchmark::State &state) {
+  const int subscribers = static_cast<int>(state.range(0));
+  std::vector<mgpp::signals::EventConstPtr> events;
+  for (int i = 0; i < subscribers; ++i) {
+    mgpp::signals::Subscribe(i, &NoopCb);
+    events.push_back(mgpp::signals::MakeEvent<mgpp::signals::Event>(i));
+  }
+
+  for (auto _ : state) {
+    for (const mgpp::signals::EventConstPtr &evt : events) {
+      mgpp::signals::Publish(evt);
+    }
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  mgpp::signals::UnsubscribeAll();
+}
+BENCHMARK(BM_PublishTopicEmulated)->Arg(1)->Arg(4)->Arg(16);
+
+// Same delivery with wildcard patterns all matching the event's topic
+static void BM_PublishTopicPatterns(benchmark::State &state) {
+  const int kTopicId = 0;
+  const char *const patterns[] = {"bench/+/load", "bench/#", "+/cpu/load",
+                                  "bench/cpu/load"};
+  mgpp::signals::RegisterTopic(kTopicId, "bench/cpu/load");
+  for (int i = 0; i < state.range(0); ++i) {
+    mgpp::signals::SubscribeTopic(patterns[i % 4], &NoopCb);
+  }
+
+  mgpp::signals::EventConstPtr evt(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(kTopicId));
+  for (auto _ : state) {
+    mgpp::signals::Publish(evt);
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  mgpp::signals::UnsubscribeAll();
+}
+BENCHMARK(BM_PublishTopicPatterns)->Arg(1)->Arg(4)->Arg(16);
+
+// Publish throughput with state.threads() threads publishing concurrently
+// while one id is subscribed
+static void BM_PublishConcurrent(benchmark::State &state) {
+  if (state.thread_index() == 0) {
+    mgpp::signals::Subscribe(0, &NoopCb);
+  }
+
+  mgpp::signals::EventConstPtr evt(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(0));
+  for (auto _ : state) {
+    mgpp::signals::Publish(evt);
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  if (state.thread_index() == 0) {
+    mgpp::signals::UnsubscribeAll();
+  }
+}
+BENCHMARK(BM_PublishConcurrent)->ThreadRange(1, 32)->UseRealTime();
+
+// Same as BM_PublishConcurrent with one dispatcher per thread, as when
+// each shard of an application runs its own bus
+static void BM_PublishSharded(benchmark::State &state) {
+  mgpp::signals::Dispatcher dispatcher;
+  dispatcher.Subscribe(0, &NoopCb);
+
+  mgpp::signals::EventConstPtr evt(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(0));
+  for (auto _ : state) {
+    dispatcher.Publish(evt);
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_PublishSharded)->ThreadRange(1, 32)->UseRealTime();
+
+// Per-slot invocation cost of a signal with state.range(0) slots
+template <typename Signal>
+static void SlotCall(benchmark::State &state) {
+  const int slots = static_cast<int>(state.range(0));
+  Signal signal;
+  for (int i = 0; i < slots; ++i) {
+    signal.connect(&NoopCb);
+  }
+
+  mgpp::signals::EventConstPtr evt(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(0));
+  for (auto _ : state) {
+    signal(evt);
+  }
+  state.SetItemsProcessed(state.iterations() * slots);
+}
+
+static void BM_SlotCallSignals2(benchmark::State &state) {
+  SlotCall<boost::signals2::signal<mgpp::signals::EventCallbackTemplate>>(
+      state);
+}
+BENCHMARK(BM_SlotCallSignals2)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+static void BM_SlotCallFlat(benchmark::State &state) {
+  SlotCall<mgpp::signals::FlatSignal>(state);
+}
+BENCHMARK(BM_SlotCallFlat)->Arg(1)->Arg(10)->Arg(100)->Arg(1000);
+
+using SensorEvent = mgpp::signals::PayloadEvent<int>;
+
+// Events from 10 sensors round-robin, for subscribers wanting only sensor 0
+static std::vector<mgpp::signals::EventConstPtr> SensorEvents() {
+  std::vector<mgpp::signals::EventConstPtr> events;
+  for (int sensor = 0; sensor < 10; ++sensor) {
+    events.push_back(mgpp::signals::MakeEvent<SensorEvent>(0, sensor));
+  }
+  return events;
+}
+
+// Cost of publishing to state.range(0) subscribers that each check the
+// sensor themselves and drop 90% of the events
+static void BM_PublishSlotFiltered(benchmark::State &state) {
+  for (int i = 0; i < state.range(0); ++i) {
+    mgpp::signals::Subscribe(0, [](const mgpp::signals::EventConstPtr &evt) {
+      if (static_cast<const SensorEvent &>(*evt).payload() == 0) {
+        NoopCb(evt);
+      }
+    });
+  }
+
+  const std::vector<mgpp::signals::EventConstPtr> events = SensorEvents();
+  std::size_t next = 0;
+  for (auto _ : state) {
+    mgpp::signals::Publish(events[next]);
+    next = next == 9 ? 0 : next + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  mgpp::signals::UnsubscribeAll();
+}
+BENCHMARK(BM_PublishSlotFiltered)->Arg(1)->Arg(10)->Arg(100);
+
+// Same subscribers with the check as an EventFilter
+static void BM_PublishEventFiltered(benchmark::State &state) {
+  for (int i = 0; i < state.range(0); ++i) {
+    mgpp::signals::Subscribe(
+        0, mgpp::signals::EventFilter::Equal(&SensorEvent::payload, 0),
+        &NoopCb);
+  }
+
+  const std::vector<mgpp::signals::EventConstPtr> events = SensorEvents();
+  std::size_t next = 0;
+  for (auto _ : state) {
+    mgpp::signals::Publish(events[next]);
+    next = next == 9 ? 0 : next + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+
+  mgpp::signals::UnsubscribeAll();
+}
+BENCHMARK(BM_PublishEventFiltered)->Arg(1)->Arg(10)->Arg(100);
+
+// Create and release one event per iteration on state.threads() threads,
+// from the event pools or straight from the heap
+static void BM_MakeEventPool(benchmark::State &state) {
+  for (auto _ : state) {
+    mgpp::signals::EventConstPtr evt(
+        mgpp::signals::MakeEvent<mgpp::signals::Event>(0));
+    benchmark::DoNotOptimize(evt.get());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MakeEventPool)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_MakeEventHeap(benchmark::State &state) {
+  for (auto _ : state) {
+    std::shared_ptr<const mgpp::signals::Event> evt(
+        std::make_shared<mgpp::signals::Event>(0));
+    benchmark::DoNotOptimize(evt.get());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_MakeEventHeap)->ThreadRange(1, 8)->UseRealTime();
+
+using BufferEvent = mgpp::signals::PayloadEvent<std::vector<char>>;
+
+// MakeEvent as it was before arguments were forwarded, copying each
+// argument into a parameter and again into the event
+template <typename T, typename... Args>
+mgpp::signals::EventRef<T> MakeEventByValue(Args... args) {
+  return mgpp::signals::MakeEvent<T>(args...);
+}
+
+// A producer filling a state.range(0) byte buffer and publishing it as an
+// event, with the buffer copied twice, copied once, or adopted by the event
+static void BM_EventPayloadByValue(benchmark::State &state) {
+  const std::size_t size = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    std::vector<char> buffer(size, 'x');
+    mgpp::signals::EventConstPtr evt(MakeEventByValue<BufferEvent>(0, buffer));
+    benchmark::DoNotOptimize(evt.get());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EventPayloadByValue)->Range(64, 1 << 20);
+
+static void BM_EventPayloadCopy(benchmark::State &state) {
+  const std::size_t size = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    std::vector<char> buffer(size, 'x');
+    mgpp::signals::EventConstPtr evt(
+        mgpp::signals::MakeEvent<BufferEvent>(0, buffer));
+    benchmark::DoNotOptimize(evt.get());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EventPayloadCopy)->Range(64, 1 << 20);
+
+static void BM_EventPayloadMove(benchmark::State &state) {
+  const std::size_t size = static_cast<std::size_t>(state.range(0));
+  for (auto _ : state) {
+    std::vector<char> buffer(size, 'x');
+    mgpp::signals::EventConstPtr evt(
+        mgpp::signals::MakeEvent<BufferEvent>(0, std::move(buffer)));
+    benchmark::DoNotOptimize(evt.get());
+  }
+  state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EventPayloadMove)->Range(64, 1 << 20);
+
+// Copy and drop a handle to one event shared by state.threads() threads, the
+// cost every by-value hop used to pay. The intrusive count lives in the
+// event, the shared_ptr count in a separate control block. Note libstdc++
+// skips the shared_ptr atomics while the process has a single thread.
+template <typename Handle>
+static void HandleCopy(benchmark::State &state, const Handle &shared) {
+  for (auto _ : state) {
+    Handle copy(shared);
+    benchmark::DoNotOptimize(copy.get());
+  }
+  state.SetItemsProcessed(state.iterations());
+}
+
+static void BM_HandleCopySharedPtr(benchmark::State &state) {
+  static const std::shared_ptr<const mgpp::signals::Event> evt(
+      std::make_shared<mgpp::signals::Event>(0));
+  HandleCopy(state, evt);
+}
+BENCHMARK(BM_HandleCopySharedPtr)->ThreadRange(1, 8)->UseRealTime();
+
+static void BM_HandleCopyEventRef(benchmark::State &state) {
+  static const mgpp::signals::EventConstPtr evt(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(0));
+  HandleCopy(state, evt);
+}
+BENCHMARK(BM_HandleCopyEventRef)->ThreadRange(1, 8)->UseRealTime();
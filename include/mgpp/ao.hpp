@@ -29,5 +29,17 @@
 
 #include <mgpp/ao/event.hpp>
 #include <mgpp/ao/hsm.hpp>
+#include <mgpp/ao/static_hsm.hpp>
+#include <mgpp/ao/trace.hpp>
+#include <mgpp/config.hpp>
+
+// Everything that runs state machines on threads of its own
+#ifndef MGPP_EVENTS_SINGLE_THREADED
+#include <mgpp/ao/active.hpp>
+#include <mgpp/ao/bus.hpp>
+#include <mgpp/ao/kernel.hpp>
+#include <mgpp/ao/scheduler.hpp>
+#include <mgpp/ao/time_event.hpp>
+#endif
 
 #endif  // MGPP_AO_HPP_
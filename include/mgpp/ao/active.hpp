@@ -0,0 +1,133 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_AO_ACTIVE_HPP_
+#define MGPP_AO_ACTIVE_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <mgpp/ao/event.hpp>
+#include <mgpp/ao/hsm.hpp>
+#include <mgpp/config.hpp>
+#include <mgpp/mpmc_queue.hpp>
+#include <mgpp/noncopyable.hpp>
+
+#ifdef MGPP_EVENTS_SINGLE_THREADED
+// Events are posted to an active object from any thread
+#error "mgpp::ao: Active needs thread-safe event references"
+#endif
+
+namespace mgpp {
+namespace ao {
+
+class Kernel;
+class Scheduler;
+
+// Active object: an Hsm together with its own event queue and execution
+// context.
+//
+// Events posted from any thread are queued and dispatched one at a time, so
+// each event runs to completion before the next one starts and state
+// handlers never need locking. The events are dispatched on a thread owned
+// by the active object, on whichever worker of a Scheduler picks the active
+// object up, or by a Kernel in priority order.
+class Active : private Noncopyable {
+ public:
+  Active(std::unique_ptr<Hsm> hsm, const std::size_t capacity);
+
+  // Share the scheduler's worker threads instead of owning one. The
+  // scheduler must outlive the active object.
+  Active(std::unique_ptr<Hsm> hsm, const std::size_t capacity,
+         Scheduler *scheduler);
+
+  // Let the kernel dispatch the events, ahead of those of every active
+  // object with a lower priority. Priorities run from 1 to
+  // Kernel::kMaxPriority and must be unique within a kernel. The kernel must
+  // outlive the active object.
+  Active(std::unique_ptr<Hsm> hsm, const std::size_t capacity, Kernel *kernel,
+         const unsigned priority);
+  virtual ~Active();
+
+  // Run the initial transition and start dispatching queued events
+  void Start();
+
+  // Dispatch whatever is still queued, then stop dispatching. Called on
+  // the thread running the kernel, e.g. from a handler, an active object
+  // of that kernel stops at once and keeps its queue for the next Start.
+  void Stop();
+
+  // Queue an event from any thread. Returns false if the queue is full.
+  bool Post(EventConstPtr evt);
+
+  // Queue an event ahead of everything already posted. Only valid from the
+  // active object's own thread, e.g. to recall an event from a handler.
+  void PostLifo(EventConstPtr evt);
+
+  Hsm &hsm() const { return *hsm_; }
+
+ private:
+  friend class Kernel;
+  friend class Scheduler;
+
+  Active(std::unique_ptr<Hsm> hsm, const std::size_t capacity,
+         Scheduler *scheduler, Kernel *kernel, const unsigned priority);
+
+  void Run();
+  bool RunSlice();
+  void Release();
+  bool DispatchOne();
+  void Wake();
+
+  std::unique_ptr<Hsm> hsm_;
+  MpmcQueue<EventConstPtr> queue_;
+  std::vector<EventConstPtr> lifo_;
+
+  // Guards stop_ and the sleeps on not_empty_; the queue itself is lock-free
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  bool stop_;
+  std::atomic<bool> waiting_;
+  std::thread thread_;
+
+  // Set while the active object sits in, or is run from, a scheduler deque
+  Scheduler *const scheduler_;
+  std::atomic<bool> scheduled_;
+  bool started_;
+
+  Kernel *const kernel_;
+  const unsigned priority_;
+};
+
+}  // namespace ao
+}  // namespace mgpp
+
+#endif  // MGPP_AO_ACTIVE_HPP_
@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_AO_BUS_HPP_
+#define MGPP_AO_BUS_HPP_
+
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+
+#include <mgpp/ao/event.hpp>
+#include <mgpp/config.hpp>
+#include <mgpp/noncopyable.hpp>
+#include <mgpp/signals/dispatcher.hpp>
+
+#ifdef MGPP_EVENTS_SINGLE_THREADED
+// Published events fan out to active objects on their own threads
+#error "mgpp::ao: Bus needs thread-safe event references"
+#endif
+
+namespace mgpp {
+namespace ao {
+
+class Active;
+
+// Subscriptions of active objects to events published through a
+// signals::Dispatcher, by default the one signals::Publish uses.
+//
+// Each subscribed active object is given one bit, and each event id a mask
+// of the bits of its subscribers. The dispatcher sees a single slot per id,
+// which walks the set bits of the mask and posts the published handle to
+// the queue of each subscriber, so fanning out to many active objects costs
+// no callback per subscriber. An event published while an active object
+// unsubscribes may still reach it, but none does once Unsubscribe or
+// UnsubscribeAll has returned, so the active object may then be destroyed.
+class Bus : private Noncopyable {
+ public:
+  static const std::size_t kMaxSubscribers = 256;
+
+  Bus();
+  // The dispatcher must outlive the bus
+  explicit Bus(signals::Dispatcher &dispatcher);
+  ~Bus();
+
+  // Throws std::length_error if kMaxSubscribers other active objects are
+  // subscribed already
+  void Subscribe(Active *active, const int id);
+  void Unsubscribe(Active *active, const int id);
+  void UnsubscribeAll(Active *active);
+
+  std::size_t NumSubscribers(const int id) const;
+
+  // Events dropped because a subscriber's queue was full
+  std::uint64_t dropped() const;
+
+ private:
+  static const std::size_t kWords = kMaxSubscribers / 64;
+
+  // What the dispatcher slots read. The slots share it, so a publish still
+  // running when the bus is destroyed finds it intact.
+  struct Shared;
+
+  struct Subscribers {
+    std::atomic<std::uint64_t> mask[kWords];
+    signals::Connection connection;
+    bool connected;
+  };
+
+  struct Subscriber {
+    std::size_t bit;
+    std::size_t ids;  // number of ids subscribed to
+  };
+
+  static void Multicast(Shared *shared, const Subscribers &subscribers,
+                        const EventConstPtr &evt);
+  // Returns true if this was the subscriber's last id and it was erased.
+  // Its bit is then kept from reuse until Release.
+  bool Clear(Subscribers *subscribers, const int id,
+             std::unordered_map<Active *, Subscriber>::iterator subscriber);
+  // Wait for the publishes that may still see what was cleared, then let
+  // Subscribe hand out `bit` again, unless it is kMaxSubscribers. Called
+  // without mutex_ held.
+  void Release(const std::size_t bit);
+
+  signals::Dispatcher &dispatcher_;
+  const std::shared_ptr<Shared> shared_;
+  mutable std::mutex mutex_;
+  std::unordered_map<Active *, Subscriber> subscribers_;
+  std::bitset<kMaxSubscribers> retiring_;
+
+  // Shared with the dispatcher slots, which point into them
+  std::unordered_map<int, std::shared_ptr<Subscribers>> ids_;
+};
+
+}  // namespace ao
+}  // namespace mgpp
+
+#endif  // MGPP_AO_BUS_HPP_
@@ -27,6 +27,8 @@
 #ifndef MGPP_AO_EVENT_HPP_
 #define MGPP_AO_EVENT_HPP_
 
+#include <utility>
+
 #include <mgpp/signals/event.hpp>
 
 namespace mgpp {
@@ -37,9 +39,19 @@ using Event = mgpp::signals::Event;
 using EventPtr = mgpp::signals::EventPtr;
 using EventConstPtr = mgpp::signals::EventConstPtr;
 
+template <typename T>
+using EventRef = mgpp::signals::EventRef<T>;
+template <typename T>
+using PayloadEvent = mgpp::signals::PayloadEvent<T>;
+
 template <typename T, typename... Args>
-std::shared_ptr<T> MakeEvent(Args... args) {
-  return mgpp::signals::MakeEvent<T>(args...);
+EventRef<T> MakeEvent(Args &&... args) {
+  return mgpp::signals::MakeEvent<T>(std::forward<Args>(args)...);
+}
+
+template <int Id>
+const EventConstPtr &StaticEvent() {
+  return mgpp::signals::StaticEvent<Id>();
 }
 
 }  // namespace ao
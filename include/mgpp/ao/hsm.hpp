@@ -27,9 +27,13 @@
 #ifndef MGPP_AO_HSM_HPP_
 #define MGPP_AO_HSM_HPP_
 
+#include <array>
+#include <cstddef>
 #include <functional>
+#include <memory>
 
 #include <mgpp/ao/event.hpp>
+#include <mgpp/config.hpp>
 #include <mgpp/noncopyable.hpp>
 
 namespace mgpp {
@@ -55,24 +59,46 @@ enum StateAction {
 class Hsm;
 
 // using StateHandler =
-// std::function<StateAction (Hsm * const me, EventConstPtr)>;
-typedef StateAction (*StateHandler)(void *const me, EventConstPtr evt);
+// std::function<StateAction (Hsm * const me, const EventConstPtr &)>;
+typedef StateAction (*StateHandler)(void *const me, const EventConstPtr &evt);
 
-// Helper functions
+// Helper functions. Only handlers taking the event by const reference
+// convert, anything else would be called with the wrong signature.
 template <class T>
-StateHandler StateCast(T handler) {
+StateHandler StateCast(StateAction (*handler)(T *const me,
+                                              const EventConstPtr &evt)) {
   return reinterpret_cast<StateHandler>(handler);
 }
 
 class Hsm : private Noncopyable {
  public:
+  static const std::size_t kMaxDepth = MGPP_HSM_MAX_DEPTH;
+  static const std::size_t kDeferCapacity = MGPP_HSM_DEFER_CAPACITY;
+
   virtual ~Hsm();
 
   virtual void Init();
-  virtual void Dispatch(EventConstPtr evt);
+  virtual void Dispatch(const EventConstPtr &evt);
+
+  // Remember which state handled each signal in each active state, so later
+  // dispatches call that state directly instead of walking up from the
+  // leaf. Only valid if the states passing a signal up always do so, i.e.
+  // no state between the leaf and the handler guards on the event.
+  void EnableDispatchTable();
+
+  // Dispatch a batch of events in order, as a single non-virtual loop.
+  // Returns the number of transitions taken. Overrides of Dispatch are not
+  // called.
+  std::size_t DispatchBatch(const EventConstPtr *events, std::size_t count);
+
+  template <class Iterator>
+  std::size_t DispatchBatch(Iterator first, Iterator last);
 
   StateHandler state() const;
 
+  // Number of events held by Defer and not yet dispatched
+  std::size_t deferred() const;
+
  protected:
   explicit Hsm(StateHandler initial);
 
@@ -87,23 +113,79 @@ class Hsm : private Noncopyable {
 
   StateAction Handled();
 
-  static StateAction Top(Hsm *const me, EventConstPtr evt);
+  // Hold an event back until a state is ready for it. Returns false if
+  // kDeferCapacity events are already deferred.
+  bool Defer(const EventConstPtr &evt);
+
+  // Dispatch the oldest deferred event as soon as the current one has run
+  // to completion, ahead of anything dispatched after it. Typically called
+  // from an entry action. Returns false if nothing is deferred.
+  bool Recall();
+
+  static StateAction Top(Hsm *const me, const EventConstPtr &evt);
 
  private:
+  // Exit and entry sequence of a transition, recorded the first time it is
+  // taken. The hierarchy described by the state handlers never changes, so
+  // the path from a given active state and source to a target is always
+  // the same and can be replayed without probing super states. State
+  // handlers are unique to their class, so the paths are cached per thread
+  // and shared by every instance rather than stored in each one.
+  struct TransitionPath {
+    StateHandler state;
+    StateHandler source;
+    StateHandler target;
+    StateHandler common;  // active state once the exits are done
+    std::size_t exits;    // path[0, exits) is exited, the rest entered
+    std::size_t length;
+    StateHandler path[2 * kMaxDepth];
+  };
+
+  // State that last handled a signal while another state was active
+  struct DispatchEntry {
+    StateHandler state;
+    int signal;
+    StateHandler handler;
+  };
+
+  static const std::size_t kPathCacheSize = 64;
+  static const std::size_t kDispatchTableSize = 64;
+
   StateHandler state_;
   StateHandler temp_;
-  EventConstPtr super_evt_;
-  EventConstPtr init_evt_;
-  EventConstPtr entry_evt_;
-  EventConstPtr exit_evt_;
-
+  std::unique_ptr<DispatchEntry[]> dispatch_table_;
+  std::size_t transitions_;
+  std::array<EventConstPtr, kDeferCapacity> deferred_;
+  std::size_t deferred_head_;
+  std::size_t deferred_count_;
+  std::size_t recalled_;  // deferred events at the head due for dispatch
+
+  void DispatchEvent(const EventConstPtr &evt);
+  void DispatchRecalled();
+
+  static TransitionPath &CachedPath(StateHandler state, StateHandler source,
+                                    StateHandler target);
   void EnterState(StateHandler state);
-  void ExitState();
+  StateHandler SuperOf(StateHandler state);
+  void FindPath(StateHandler source, StateHandler target,
+                TransitionPath *path);
   StateAction InitialTransition(StateHandler target);
   StateAction Transition(StateHandler target);
   StateAction Super(StateHandler state);
 };
 
+template <class Iterator>
+std::size_t Hsm::DispatchBatch(Iterator first, Iterator last) {
+  const std::size_t transitions = transitions_;
+  for (; first != last; ++first) {
+    DispatchEvent(*first);
+    if (recalled_ > 0) {
+      DispatchRecalled();
+    }
+  }
+  return transitions_ - transitions;
+}
+
 template <class T>
 StateAction Hsm::InitialTransition(T target) {
   return this->InitialTransition(StateCast(target));
@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_AO_KERNEL_HPP_
+#define MGPP_AO_KERNEL_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+
+#include <mgpp/config.hpp>
+#include <mgpp/noncopyable.hpp>
+
+#ifdef MGPP_EVENTS_SINGLE_THREADED
+// The kernel runs Active objects, which take posts from any thread
+#error "mgpp::ao: Kernel needs thread-safe event references"
+#endif
+
+namespace mgpp {
+namespace ao {
+
+class Active;
+
+// Cooperative priority kernel, after the QV kernel of the QP frameworks.
+//
+// Run() dispatches events on the calling thread. Each step takes the
+// highest priority active object with queued events and dispatches exactly
+// one of its events to completion, so a higher priority object waits for
+// at most one lower priority event. Ready objects are tracked in a bitmap,
+// one bit per priority, which makes each scheduling decision O(1).
+//
+// When nothing is ready the kernel calls the idle hook, or sleeps until an
+// event is posted if there is none. The hook runs on the kernel thread and
+// is where a control loop would e.g. poll hardware or halt the core.
+class Kernel : private Noncopyable {
+ public:
+  static const unsigned kMaxPriority = 64;
+
+  explicit Kernel(std::function<void()> idle = nullptr);
+  ~Kernel();
+
+  // Dispatch events on the calling thread until Stop is called
+  void Run();
+
+  // Make Run return after the event being dispatched. Any thread.
+  void Stop();
+
+  bool running() const { return running_; }
+
+ private:
+  friend class Active;
+
+  void Attach(Active *active, const unsigned priority);
+  void Detach(const unsigned priority);
+  void MakeReady(const unsigned priority);
+  bool Ready(const unsigned priority) const;
+
+  // Whether the calling thread is in this kernel's Run, e.g. in a handler
+  bool OnKernelThread() const;
+
+  void Step(const unsigned index);
+  void Idle();
+
+  std::function<void()> idle_;
+
+  // Bit i is set while the active object of priority i + 1 may have events
+  std::atomic<std::uint64_t> ready_;
+  std::atomic<Active *> actives_[kMaxPriority];
+
+  // Active object being dispatched, so Detach can wait it out
+  std::atomic<Active *> current_;
+
+  std::atomic<bool> running_;
+  std::atomic<bool> stop_;
+
+  // Without an idle hook, Run sleeps on not_empty_ while nothing is ready
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::atomic<bool> waiting_;
+};
+
+}  // namespace ao
+}  // namespace mgpp
+
+#endif  // MGPP_AO_KERNEL_HPP_
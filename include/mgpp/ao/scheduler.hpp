@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_AO_SCHEDULER_HPP_
+#define MGPP_AO_SCHEDULER_HPP_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <mgpp/config.hpp>
+#include <mgpp/noncopyable.hpp>
+
+#ifdef MGPP_EVENTS_SINGLE_THREADED
+// Workers dispatch events posted on other threads
+#error "mgpp::ao: Scheduler needs thread-safe event references"
+#endif
+
+namespace mgpp {
+namespace ao {
+
+class Active;
+
+// Runs any number of active objects on a fixed pool of worker threads.
+//
+// An active object with queued events sits in exactly one worker's deque
+// until a worker takes it and dispatches a slice of its events, so one Hsm
+// is never dispatched on two threads at once. Workers take from the back of
+// their own deque, which keeps recently posted objects hot in cache, and
+// idle workers steal from the front of the others'.
+//
+// Every active object using the scheduler must be stopped before the
+// scheduler is destroyed.
+class Scheduler : private Noncopyable {
+ public:
+  explicit Scheduler(const std::size_t workers);
+  ~Scheduler();
+
+  std::size_t workers() const { return workers_.size(); }
+
+ private:
+  friend class Active;
+  struct Worker;
+
+  // Queue an active object that has events and is not already queued
+  void Schedule(Active *active);
+
+  void Run(const std::size_t index);
+  void Push(const std::size_t index, Active *active, const bool front);
+  bool Pop(const std::size_t index, Active **active);
+  bool Steal(const std::size_t thief, Active **active);
+
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::thread> threads_;
+  std::atomic<std::size_t> next_worker_;
+  std::atomic<std::size_t> queued_;
+
+  // Idle workers sleep on not_empty_ while no active object is queued
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  bool stop_;
+  std::atomic<int> sleepers_;
+};
+
+}  // namespace ao
+}  // namespace mgpp
+
+#endif  // MGPP_AO_SCHEDULER_HPP_
@@ -0,0 +1,298 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_AO_STATIC_HSM_HPP_
+#define MGPP_AO_STATIC_HSM_HPP_
+
+#include <type_traits>
+
+#include <mgpp/ao/event.hpp>
+#include <mgpp/ao/hsm.hpp>
+#include <mgpp/noncopyable.hpp>
+
+namespace mgpp {
+namespace ao {
+
+// Root of every static state tree. It has no handlers and ignores all events.
+struct TopState {};
+
+// Base of the states of a StaticHsm. Each state is a type naming its parent,
+// and hides whichever of the default handlers below it needs:
+//
+//   struct Idle : mgpp::ao::StaticState<Idle> {
+//     static void Entry(MyHsm &me);
+//     static StateAction Handle(MyHsm &me, const EventConstPtr &evt) {
+//       return evt->id() == GO_SIG ? TransitionTo<Busy>(me) : ACTION_SUPER;
+//     }
+//   };
+//
+// Init runs after the state has been entered as the target of a transition
+// and may drill down with InitialTransitionTo.
+template <class Self, class ParentState = TopState>
+struct StaticState {
+  typedef ParentState Parent;
+
+  template <class Machine>
+  static void Entry(Machine &me) {
+    (void)me;
+  }
+
+  template <class Machine>
+  static void Exit(Machine &me) {
+    (void)me;
+  }
+
+  template <class Machine>
+  static StateAction Init(Machine &me) {
+    (void)me;
+    return ACTION_HANDLED;
+  }
+
+  template <class Machine>
+  static StateAction Handle(Machine &me, const EventConstPtr &evt) {
+    (void)me;
+    (void)evt;
+    return ACTION_SUPER;
+  }
+
+  template <class Target, class Machine>
+  static StateAction TransitionTo(Machine &me) {
+    return me.template Transition<Self, Target>();
+  }
+
+  template <class Target, class Machine>
+  static StateAction InitialTransitionTo(Machine &me) {
+    return me.template InitialTransition<Self, Target>();
+  }
+};
+
+namespace detail {
+
+template <class Ancestor, class State>
+struct IsAncestorOrSelf
+    : std::integral_constant<
+          bool, std::is_same<Ancestor, State>::value ||
+                    IsAncestorOrSelf<Ancestor, typename State::Parent>::value> {
+};
+
+template <class Ancestor>
+struct IsAncestorOrSelf<Ancestor, TopState>
+    : std::is_same<Ancestor, TopState> {};
+
+// Innermost state containing both State and Target
+template <class State, class Target,
+          bool = IsAncestorOrSelf<State, Target>::value>
+struct CommonAncestor {
+  typedef State type;
+};
+
+template <class State, class Target>
+struct CommonAncestor<State, Target, false> {
+  typedef typename CommonAncestor<typename State::Parent, Target>::type type;
+};
+
+// State a transition from Source to Target exits down to. Like ao::Hsm, a
+// transition to self exits and re-enters the source, while a transition to
+// an ancestor or descendant of the source leaves the outer state alone.
+template <class Source, class Target>
+struct TransitionScope {
+  typedef typename std::conditional<
+      std::is_same<Source, Target>::value, typename Source::Parent,
+      typename CommonAncestor<Source, Target>::type>::type type;
+};
+
+// Exit From and its ancestors up to, but not including, To
+template <class From, class To>
+struct ExitChain {
+  template <class Machine>
+  static void Run(Machine &me) {
+    From::Exit(me);
+    ExitChain<typename From::Parent, To>::Run(me);
+  }
+};
+
+template <class To>
+struct ExitChain<To, To> {
+  template <class Machine>
+  static void Run(Machine &me) {
+    (void)me;
+  }
+};
+
+// Enter the descendants of From down to, and including, To
+template <class From, class To>
+struct EnterChain {
+  template <class Machine>
+  static void Run(Machine &me) {
+    EnterChain<From, typename To::Parent>::Run(me);
+    To::Entry(me);
+  }
+};
+
+template <class To>
+struct EnterChain<To, To> {
+  template <class Machine>
+  static void Run(Machine &me) {
+    (void)me;
+  }
+};
+
+}  // namespace detail
+
+// HSM whose state tree is declared as types. Transition paths are resolved
+// at compile time and an event reaches its handler through one indirect
+// call to a function that has the whole chain of ancestors inlined, instead
+// of probing each super state at runtime as ao::Hsm does.
+template <class Derived, class Initial>
+class StaticHsm : private Noncopyable {
+ public:
+  void Init();
+  void Dispatch(const EventConstPtr &evt);
+
+  // True if State is the active leaf state
+  template <class State>
+  bool IsIn() const;
+
+ protected:
+  StaticHsm() : active_(nullptr) {}
+
+  template <class Source, class Target>
+  StateAction Transition();
+
+  template <class Source, class Target>
+  StateAction InitialTransition();
+
+ private:
+  template <class, class>
+  friend struct StaticState;
+
+  struct StateInfo {
+    StateAction (*dispatch)(Derived &me, const EventConstPtr &evt);
+    void (*exit_until)(Derived &me, const StateInfo *stop);
+  };
+
+  // Handlers of State and its ancestors, generated per state
+  template <class State, class Unused = void>
+  struct Node {
+    typedef typename State::Parent Parent;
+
+    static StateAction Dispatch(Derived &me, const EventConstPtr &evt) {
+      StateAction action = State::Handle(me, evt);
+      return action == ACTION_SUPER ? Node<Parent>::Dispatch(me, evt)
+                                    : action;
+    }
+
+    static void ExitUntil(Derived &me, const StateInfo *stop) {
+      if (&Info<State>::value != stop) {
+        State::Exit(me);
+        Node<Parent>::ExitUntil(me, stop);
+      }
+    }
+  };
+
+  template <class Unused>
+  struct Node<TopState, Unused> {
+    static StateAction Dispatch(Derived &me, const EventConstPtr &evt) {
+      (void)me;
+      (void)evt;
+      return ACTION_IGNORED;
+    }
+
+    static void ExitUntil(Derived &me, const StateInfo *stop) {
+      (void)me;
+      (void)stop;
+    }
+  };
+
+  template <class State>
+  struct Info {
+    static const StateInfo value;
+  };
+
+  Derived &derived() { return static_cast<Derived &>(*this); }
+
+  const StateInfo *active_;
+};
+
+template <class Derived, class Initial>
+template <class State>
+const typename StaticHsm<Derived, Initial>::StateInfo
+    StaticHsm<Derived, Initial>::Info<State>::value = {
+        &StaticHsm<Derived, Initial>::Node<State>::Dispatch,
+        &StaticHsm<Derived, Initial>::Node<State>::ExitUntil};
+
+template <class Derived, class Initial>
+void StaticHsm<Derived, Initial>::Init() {
+  InitialTransition<TopState, Initial>();
+}
+
+template <class Derived, class Initial>
+void StaticHsm<Derived, Initial>::Dispatch(const EventConstPtr &evt) {
+  active_->dispatch(derived(), evt);
+}
+
+template <class Derived, class Initial>
+template <class State>
+bool StaticHsm<Derived, Initial>::IsIn() const {
+  return active_ == &Info<State>::value;
+}
+
+template <class Derived, class Initial>
+template <class Source, class Target>
+StateAction StaticHsm<Derived, Initial>::Transition() {
+  typedef typename detail::TransitionScope<Source, Target>::type Scope;
+
+  // The active state may be a descendant of the source that passed the
+  // event up, so exit up to the source first. This is the only part of the
+  // path that is not known at compile time.
+  active_->exit_until(derived(), &Info<Source>::value);
+  detail::ExitChain<Source, Scope>::Run(derived());
+  detail::EnterChain<Scope, Target>::Run(derived());
+  active_ = &Info<Target>::value;
+
+  // Perform initial transition on target
+  Target::Init(derived());
+
+  return ACTION_TRANSITION;
+}
+
+template <class Derived, class Initial>
+template <class Source, class Target>
+StateAction StaticHsm<Derived, Initial>::InitialTransition() {
+  static_assert(detail::IsAncestorOrSelf<Source, Target>::value,
+                "initial transition target must be nested in its source");
+
+  detail::EnterChain<Source, Target>::Run(derived());
+  active_ = &Info<Target>::value;
+  Target::Init(derived());
+
+  return ACTION_INITIAL_TRANSITION;
+}
+
+}  // namespace ao
+}  // namespace mgpp
+
+#endif  // MGPP_AO_STATIC_HSM_HPP_
@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_AO_TIME_EVENT_HPP_
+#define MGPP_AO_TIME_EVENT_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+
+#include <mgpp/ao/event.hpp>
+#include <mgpp/config.hpp>
+#include <mgpp/noncopyable.hpp>
+
+#ifdef MGPP_EVENTS_SINGLE_THREADED
+// The timer thread posts the events it fires
+#error "mgpp::ao: TimeEvent needs thread-safe event references"
+#endif
+
+namespace mgpp {
+namespace ao {
+
+class Active;
+class TimeEvent;
+
+// Hierarchical timing wheel counting time in ticks. Four levels of 256
+// slots cover 2^32 ticks; timeouts further out are parked in the last level
+// until they come within range. Arming and disarming a time event is O(1)
+// whatever the number of events armed.
+//
+// Tick is either called by the application, e.g. from its own periodic
+// interrupt or timerfd, or by the thread Start launches.
+class TimerWheel : private Noncopyable {
+ public:
+  TimerWheel();
+  ~TimerWheel();
+
+  // Advance time by one tick and post every time event that expires
+  void Tick();
+
+  // Tick from a thread of the wheel's own, once per period
+  void Start(std::chrono::nanoseconds period);
+  void Stop();
+
+  // Ticks since the wheel was created
+  std::uint64_t now() const;
+
+ private:
+  friend class TimeEvent;
+
+  static const unsigned kLevels = 4;
+  static const unsigned kSlotBits = 8;
+  static const unsigned kSlots = 1u << kSlotBits;
+
+  void Insert(TimeEvent *event);
+  void Remove(TimeEvent *event);
+  void Cascade(unsigned level);
+
+  mutable std::mutex mutex_;
+  std::uint64_t now_;
+  TimeEvent *slots_[kLevels][kSlots];
+
+  std::mutex thread_mutex_;
+  std::condition_variable stopped_;
+  bool stop_;
+  std::thread thread_;
+};
+
+// Event an active object posts to itself after a timeout, once or
+// periodically. It is owned by its creator and posted as is, so it must
+// outlive the active object's queue, and is never copied or freed by the
+// handles to it. An expiry that finds the target's queue full is dropped.
+class TimeEvent : public Event {
+ public:
+  TimeEvent(int id, Active *target, TimerWheel *wheel);
+  ~TimeEvent();
+
+  TimeEvent(const TimeEvent &) = delete;
+  TimeEvent &operator=(const TimeEvent &) = delete;
+
+  // Post to the target after `ticks` ticks, then every `interval` ticks
+  // unless it is 0. Arming an armed event restarts it.
+  void Arm(std::uint64_t ticks, std::uint64_t interval = 0);
+
+  // Returns false if the event was not armed, e.g. it has just expired
+  bool Disarm();
+
+  // Restart the timeout, keeping the interval. Returns whether the event
+  // was armed before.
+  bool Rearm(std::uint64_t ticks);
+
+  bool armed() const;
+
+ private:
+  friend class TimerWheel;
+
+  Active *const target_;
+  TimerWheel *const wheel_;
+  std::uint64_t expiry_;
+  std::uint64_t interval_;
+
+  // Links in the wheel slot holding the event, null while disarmed
+  TimeEvent **slot_;
+  TimeEvent *next_;
+  TimeEvent *prev_;
+};
+
+}  // namespace ao
+}  // namespace mgpp
+
+#endif  // MGPP_AO_TIME_EVENT_HPP_
@@ -0,0 +1,112 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_AO_TRACE_HPP_
+#define MGPP_AO_TRACE_HPP_
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <mgpp/ao/hsm.hpp>
+#include <mgpp/config.hpp>
+#include <mgpp/noncopyable.hpp>
+
+namespace mgpp {
+namespace ao {
+
+enum TraceRecordType {
+  TRACE_DISPATCH,    // event dispatched to the active state
+  TRACE_ENTRY,       // state entered
+  TRACE_EXIT,        // state exited
+  TRACE_INIT,        // initial transition to the state
+  TRACE_TRANSITION,  // transition to the state
+};
+
+// One step of a state machine, as written to trace files. Integers are
+// in the byte order of the machine that recorded them.
+struct TraceRecord {
+  std::uint64_t timestamp;  // steady clock, in ns
+  std::uint64_t object;     // address of the Hsm
+  std::uint64_t state;      // address of the state handler
+  std::int32_t signal;      // event id, -1 for transitions
+  std::uint16_t type;       // TraceRecordType
+  std::uint16_t thread;     // recording thread, numbered from 0
+};
+
+static_assert(sizeof(TraceRecord) == 32, "trace records must pack");
+
+// Append a record to the calling thread's buffer. Never blocks or
+// allocates once the thread has traced its first record. Hsm traces its
+// dispatches, transitions, entries and exits this way when built with
+// MGPP_AO_TRACE.
+void TraceEvent(TraceRecordType type, const void *object, StateHandler state,
+                int signal);
+
+// Move up to `max` buffered records, of every thread, to `out` and return
+// how many were moved. Records of one thread keep their order.
+std::size_t DrainTrace(TraceRecord *out, std::size_t max);
+
+// Records dropped so far because a buffer was full
+std::uint64_t TraceDropped();
+
+// Trace file mapped into memory, so flushing is a copy into the page
+// cache and the kernel writes it back. The file is cut down to the
+// records written when closed.
+class TraceFile : private Noncopyable {
+ public:
+  // Create or truncate `path`, with room for `capacity` records. Throws
+  // std::system_error if the file cannot be created or mapped.
+  TraceFile(const std::string &path, std::size_t capacity);
+  ~TraceFile();
+
+  // Drain the buffered records into the file and return how many were
+  // written. Records that do not fit are left buffered.
+  std::size_t Flush();
+
+  std::size_t size() const;
+  std::size_t capacity() const;
+
+ private:
+  struct Header;
+
+  int fd_;
+  void *map_;
+  std::size_t map_size_;
+  Header *header_;
+  TraceRecord *records_;
+  std::size_t capacity_;
+};
+
+// Read back the records of a trace file. Throws std::runtime_error if the
+// file cannot be read or is not a trace.
+std::vector<TraceRecord> ReadTrace(const std::string &path);
+
+}  // namespace ao
+}  // namespace mgpp
+
+#endif  // MGPP_AO_TRACE_HPP_
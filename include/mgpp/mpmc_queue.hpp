@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_MPMC_QUEUE_HPP_
+#define MGPP_MPMC_QUEUE_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include <mgpp/noncopyable.hpp>
+
+namespace mgpp {
+
+// Bounded lock-free multi-producer multi-consumer queue, after Dmitry
+// Vyukov's array based design. Each cell carries a sequence number telling
+// producers and consumers whose turn it is, so a push or pop costs a single
+// CAS on the uncontended path. The capacity is rounded up to a power of two.
+template <typename T>
+class MpmcQueue : private Noncopyable {
+ public:
+  explicit MpmcQueue(std::size_t capacity);
+
+  template <typename U>
+  bool TryPush(U &&value);
+  bool TryPop(T *value);
+
+  // Approximate when producers or consumers are active
+  std::size_t size() const;
+  std::size_t capacity() const { return mask_ + 1; }
+
+ private:
+  struct Cell {
+    std::atomic<std::size_t> sequence;
+    T value;
+  };
+
+  static std::size_t RoundUp(std::size_t capacity);
+
+  // Producer and consumer positions live on separate cache lines. Padded
+  // rather than over-aligned so the queue can be heap allocated in C++11.
+  struct Position {
+    explicit Position(std::size_t pos) : value(pos) {}
+
+    char pad[64];
+    std::atomic<std::size_t> value;
+  };
+
+  const std::size_t mask_;
+  const std::unique_ptr<Cell[]> cells_;
+  Position enqueue_pos_;
+  Position dequeue_pos_;
+};
+
+template <typename T>
+MpmcQueue<T>::MpmcQueue(std::size_t capacity)
+    : mask_(RoundUp(capacity) - 1),
+      cells_(new Cell[mask_ + 1]),
+      enqueue_pos_(0),
+      dequeue_pos_(0) {
+  for (std::size_t i = 0; i <= mask_; ++i) {
+    cells_[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+template <typename T>
+template <typename U>
+bool MpmcQueue<T>::TryPush(U &&value) {
+  Cell *cell;
+  std::size_t pos = enqueue_pos_.value.load(std::memory_order_relaxed);
+  for (;;) {
+    cell = &cells_[pos & mask_];
+    const std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+    const std::intptr_t diff =
+        static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+    if (diff == 0) {
+      if (enqueue_pos_.value.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Full
+      return false;
+    } else {
+      pos = enqueue_pos_.value.load(std::memory_order_relaxed);
+    }
+  }
+
+  cell->value = std::forward<U>(value);
+  cell->sequence.store(pos + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+bool MpmcQueue<T>::TryPop(T *value) {
+  Cell *cell;
+  std::size_t pos = dequeue_pos_.value.load(std::memory_order_relaxed);
+  for (;;) {
+    cell = &cells_[pos & mask_];
+    const std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+    const std::intptr_t diff = static_cast<std::intptr_t>(seq) -
+                               static_cast<std::intptr_t>(pos + 1);
+    if (diff == 0) {
+      if (dequeue_pos_.value.compare_exchange_weak(
+              pos, pos + 1, std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (diff < 0) {
+      // Empty
+      return false;
+    } else {
+      pos = dequeue_pos_.value.load(std::memory_order_relaxed);
+    }
+  }
+
+  *value = std::move(cell->value);
+  cell->value = T();
+  cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+  return true;
+}
+
+template <typename T>
+std::size_t MpmcQueue<T>::size() const {
+  const std::size_t enqueued =
+      enqueue_pos_.value.load(std::memory_order_acquire);
+  const std::size_t dequeued =
+      dequeue_pos_.value.load(std::memory_order_acquire);
+  return enqueued > dequeued ? enqueued - dequeued : 0;
+}
+
+template <typename T>
+std::size_t MpmcQueue<T>::RoundUp(std::size_t capacity) {
+  std::size_t rounded = 2;
+  while (rounded < capacity) {
+    rounded <<= 1;
+  }
+  return rounded;
+}
+
+}  // namespace mgpp
+
+#endif  // MGPP_MPMC_QUEUE_HPP_
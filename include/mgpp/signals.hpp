@@ -27,7 +27,17 @@
 #ifndef MGPP_SIGNALS_HPP_
 #define MGPP_SIGNALS_HPP_
 
+#include <mgpp/config.hpp>
 #include <mgpp/signals/dispatcher.hpp>
 #include <mgpp/signals/event.hpp>
+#include <mgpp/signals/event_pool.hpp>
+#include <mgpp/signals/filter.hpp>
+#include <mgpp/signals/flat_signal.hpp>
+#include <mgpp/signals/metrics.hpp>
+#include <mgpp/signals/topic.hpp>
+
+#ifndef MGPP_EVENTS_SINGLE_THREADED
+#include <mgpp/signals/async_dispatcher.hpp>
+#endif
 
 #endif  // MGPP_SIGNALS_HPP_
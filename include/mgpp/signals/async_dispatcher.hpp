@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_SIGNALS_ASYNC_DISPATCHER_HPP_
+#define MGPP_SIGNALS_ASYNC_DISPATCHER_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include <mgpp/config.hpp>
+#include <mgpp/noncopyable.hpp>
+#include <mgpp/signals/dispatcher.hpp>
+#include <mgpp/signals/event.hpp>
+
+#ifdef MGPP_EVENTS_SINGLE_THREADED
+// Events are handed from publishing threads to the workers
+#error "mgpp::signals: AsyncDispatcher needs thread-safe event references"
+#endif
+
+namespace mgpp {
+namespace signals {
+
+// What Publish does when a worker queue is full
+enum Backpressure {
+  BACKPRESSURE_BLOCK,        // wait for the worker to make room
+  BACKPRESSURE_DROP_OLDEST,  // discard the oldest queued event
+  BACKPRESSURE_DROP_NEWEST   // discard the event being published
+};
+
+struct AsyncMetrics {
+  std::size_t depth;        // events currently queued, over all workers
+  std::size_t high_water;   // deepest any single worker queue has been
+  std::uint64_t published;  // events queued for at least one worker
+  std::uint64_t delivered;  // events dispatched by a worker, per queue
+  std::uint64_t dropped;    // events discarded by the backpressure policy,
+                            // per queue
+};
+
+// Dispatcher that delivers events on a pool of worker threads instead of on
+// the publishing thread.
+//
+// Every subscriber is pinned to one worker, and each worker drains its own
+// bounded queue in order. Events therefore reach a given subscriber in the
+// order they were queued, while subscribers on different workers run
+// concurrently. Publish only queues the event for the workers that have a
+// subscriber for its id.
+class AsyncDispatcher : private Noncopyable {
+ public:
+  AsyncDispatcher(const std::size_t workers, const std::size_t capacity,
+                  const Backpressure policy = BACKPRESSURE_BLOCK);
+  ~AsyncDispatcher();
+
+  Connection Subscribe(const int id, const EventCallback cb);
+
+  template <typename T>
+  Connection Subscribe(const int id, const EventMemberCallback<T> mcb,
+                       const T &obj) {
+    return Subscribe(id, boost::bind(mcb, const_cast<T *>(&obj),
+                                     boost::placeholders::_1));
+  }
+
+  void Unsubscribe(const int id, const Connection &conn);
+  void UnsubscribeAll(const int id = -1);
+
+  // Returns false if any worker queue discarded the event under
+  // BACKPRESSURE_DROP_NEWEST. Workers whose queues had room still deliver it,
+  // so a false return can mean a partial fan-out; metrics() counts the
+  // rejections per queue.
+  bool Publish(const EventConstPtr &event);
+
+  int NumSlots(const int id);
+
+  // Block until every event queued so far has been delivered or dropped
+  void Drain();
+
+  AsyncMetrics metrics() const;
+
+ private:
+  class Worker;
+  struct RouteTable;
+
+  void Replace(const RouteTable *routes);
+
+  const Backpressure policy_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::atomic<std::uint64_t> published_;
+
+  std::mutex mutex_;
+  std::size_t next_worker_;
+  std::atomic<const RouteTable *> routes_;
+};
+
+}  // namespace signals
+}  // namespace mgpp
+
+#endif  // MGPP_SIGNALS_ASYNC_DISPATCHER_HPP_
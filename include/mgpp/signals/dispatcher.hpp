@@ -27,24 +27,178 @@
 #ifndef MGPP_SIGNALS_DISPATCHER_HPP_
 #define MGPP_SIGNALS_DISPATCHER_HPP_
 
+#include <atomic>
+#include <cstddef>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
 #include <unordered_map>
+#include <utility>
+#include <vector>
 
+#include <boost/bind/bind.hpp>
+#include <mgpp/config.hpp>
+#ifndef MGPP_SIGNALS_FLAT_SLOTS
 #include <boost/signals2.hpp>
+#endif
 #include <mgpp/signals/event.hpp>
+#include <mgpp/signals/filter.hpp>
+#include <mgpp/signals/flat_signal.hpp>
+#include <mgpp/signals/metrics.hpp>
+
+// Default number of ids, starting at 0, kept in a dispatcher's directly
+// indexed table. Ids outside this range are looked up in a hash map.
+#ifndef MGPP_SIGNALS_DENSE_IDS
+#define MGPP_SIGNALS_DENSE_IDS 1024
+#endif
 
 namespace mgpp {
 namespace signals {
 
 // Define callback templates and pointer types
-using EventCallbackTemplate = void(EventConstPtr);
+using EventCallbackTemplate = void(const EventConstPtr &);
 using EventCallback = std::function<EventCallbackTemplate>;
 template <typename T>
-using EventMemberCallback = void (T::*)(EventConstPtr);
+using EventMemberCallback = void (T::*)(const EventConstPtr &);
 
+#ifdef MGPP_SIGNALS_FLAT_SLOTS
+// Use the in-house flat slot list for the event dispatcher
+typedef FlatSignal EventSignal;
+typedef FlatConnection Connection;
+#else
 // Use boost signals2 signals/slots for the event dispatcher
 typedef boost::signals2::signal<EventCallbackTemplate> EventSignal;
 typedef boost::signals2::connection Connection;
+#endif
+
+namespace detail {
+class DispatcherStats;
+class TopicRouter;
+}  // namespace detail
+
+// Handle to a topic pattern subscription, for UnsubscribeTopic. See
+// topic.hpp for topics and patterns.
+class TopicSubscription {
+ public:
+  TopicSubscription() : key_(0) {}
+
+  bool valid() const { return key_ != 0; }
+
+ private:
+  friend class detail::TopicRouter;
+
+  explicit TopicSubscription(const std::size_t key) : key_(key) {}
+
+  std::size_t key_;
+};
+
+// Synchronous event dispatcher: Publish calls the slots subscribed to the
+// event's id on the publishing thread.
+//
+// Dispatchers are independent of each other, so components that never
+// exchange events can each publish through their own, e.g. one per shard
+// or core, without sharing its table or its signals. The free functions
+// below use the default dispatcher, Instance().
+//
+// The id to signal table is copy-on-write. Readers (Publish, NumSlots) load
+// the current table under an epoch guard and never block. Writers serialize
+// on a mutex, install a modified copy and retire the previous table once no
+// reader can still be using it. Signals are shared between table copies and
+// are themselves safe to connect to and invoke concurrently.
+class Dispatcher {
+ public:
+  explicit Dispatcher(const int dense_limit = MGPP_SIGNALS_DENSE_IDS);
+  ~Dispatcher();
+
+  Dispatcher(const Dispatcher &) = delete;
+  Dispatcher &operator=(const Dispatcher &) = delete;
+  Dispatcher(Dispatcher &&) = delete;
+  Dispatcher &operator=(Dispatcher &&) = delete;
+
+  Connection Subscribe(const int id, const EventCallback cb);
+
+  template <typename T>
+  Connection Subscribe(const int id, const EventMemberCallback<T> mcb,
+                       const T &obj) {
+    return Subscribe(id, boost::bind(mcb, const_cast<T *>(&obj),
+                                     boost::placeholders::_1));
+  }
+
+  // Subscribe to the events of `id` passing `filter`. Slots subscribed with
+  // equal filters share one dispatcher slot, which checks the filter once
+  // per event and calls none of them if it fails.
+  Connection Subscribe(const int id, const EventFilter &filter,
+                       const EventCallback cb);
+
+  template <typename T>
+  Connection Subscribe(const int id, const EventFilter &filter,
+                       const EventMemberCallback<T> mcb, const T &obj) {
+    return Subscribe(id, filter, boost::bind(mcb, const_cast<T *>(&obj),
+                                             boost::placeholders::_1));
+  }
+
+  void Unsubscribe(const int id, const Connection &conn);
+
+  // Also drops every topic pattern subscription when `id` is -1
+  void UnsubscribeAll(const int id = -1);
+  void Publish(const EventConstPtr &event);
+
+  // Topics of this dispatcher's ids, see topic.hpp
+  void RegisterTopic(const int id, const std::string &topic);
+  TopicSubscription SubscribeTopic(const std::string &pattern,
+                                   const EventCallback cb);
+
+  template <typename T>
+  TopicSubscription SubscribeTopic(const std::string &pattern,
+                                   const EventMemberCallback<T> mcb,
+                                   const T &obj) {
+    return SubscribeTopic(pattern, boost::bind(mcb, const_cast<T *>(&obj),
+                                               boost::placeholders::_1));
+  }
+
+  void UnsubscribeTopic(const TopicSubscription &subscription);
+  std::vector<int> MatchTopic(const std::string &pattern);
+
+  // Number of slots called for `id`, counting each group of slots sharing
+  // a filter once
+  int NumSlots(const int id);
+
+  // Ids in [0, limit) are looked up by direct indexing, others are hashed
+  void SetDenseIds(const int limit);
+
+  // Metrics of the events published through this dispatcher alone. Empty
+  // unless the library is built with MGPP_SIGNALS_METRICS, see metrics.hpp.
+  std::vector<IdMetrics> id_metrics() const;
+  std::vector<SlotMetrics> slot_metrics() const;
+  void DumpMetrics(std::ostream &out) const;
+  void ResetMetrics();
+
+  // Default dispatcher, used by the free functions
+  static Dispatcher &Instance();
+
+ private:
+  class SignalTable;
+
+  // Slots subscribed to an id with equal filters
+  struct FilterGroup {
+    std::shared_ptr<EventSignal> slots;
+    Connection connection;  // of the group to the id's signal
+  };
+
+  using FilterKey = std::pair<int, std::string>;
+
+  void Replace(const SignalTable *table);
+  Connection Connect(const int id, const EventCallback &slot);
+  void RemoveFilters(const int id, const bool all);
+
+  std::mutex mutex_;
+  std::atomic<const SignalTable *> signals_;
+  std::map<FilterKey, FilterGroup> filters_;
+  std::unique_ptr<detail::DispatcherStats> stats_;  // null without metrics
+  std::unique_ptr<detail::TopicRouter> topics_;
+};
 
 // Subscribe functions
 Connection Subscribe(const int id, const EventCallback cb);
@@ -52,7 +206,21 @@ Connection Subscribe(const int id, const EventCallback cb);
 template <typename T>
 Connection Subscribe(const int id, const EventMemberCallback<T> mcb,
                      const T &obj) {
-  return Subscribe(id, boost::bind(mcb, const_cast<T *>(&obj), _1));
+  return Subscribe(id, boost::bind(mcb, const_cast<T *>(&obj),
+                                   boost::placeholders::_1));
+}
+
+// Subscribe to the events of `id` passing `filter`. Slots subscribed with
+// equal filters share one dispatcher slot, which checks the filter once per
+// event and calls none of them if it fails.
+Connection Subscribe(const int id, const EventFilter &filter,
+                     const EventCallback cb);
+
+template <typename T>
+Connection Subscribe(const int id, const EventFilter &filter,
+                     const EventMemberCallback<T> mcb, const T &obj) {
+  return Subscribe(id, filter, boost::bind(mcb, const_cast<T *>(&obj),
+                                           boost::placeholders::_1));
 }
 
 // Unsubscribe functions
@@ -62,10 +230,15 @@ void Unsubscribe(const int id, const Connection &conn);
 void UnsubscribeAll(const int id = -1);
 
 // Publish function
-void Publish(EventConstPtr event);
+void Publish(const EventConstPtr &event);
 
+// Number of slots the dispatcher calls for `id`, counting each group of
+// slots sharing a filter once
 int NumSlots(const int id);
 
+// Ids in [0, limit) are looked up by direct indexing, others are hashed
+void SetDenseIds(const int limit);
+
 }  // namespace signals
 }  // namespace mgpp
 
@@ -27,28 +27,252 @@
 #ifndef MGPP_SIGNALS_EVENT_HPP_
 #define MGPP_SIGNALS_EVENT_HPP_
 
-#include <memory>
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+#include <mgpp/config.hpp>
+#include <mgpp/signals/event_pool.hpp>
 
 namespace mgpp {
 namespace signals {
 
+class Event;
+
+template <typename T>
+class EventRef;
+
+template <typename T, typename... Args>
+EventRef<T> MakeEvent(Args &&... args);
+
+template <int Id>
+const EventRef<const Event> &StaticEvent();
+
+// Events carry their own reference count, so handles to them are a single
+// pointer and copying one costs one increment. The count is atomic unless
+// MGPP_EVENTS_SINGLE_THREADED is defined, in which case events must never
+// be shared between threads, and the components that share them, such as
+// AsyncDispatcher and ao::Active, refuse to compile.
 class Event {
  public:
-  explicit Event(int id) : id_(id) {}
+  explicit Event(int id) : id_(id), refs_(0), pool_(detail::kHeapPool) {}
+
+  // A copy is a new event with a count of its own
+  Event(const Event &other)
+      : id_(other.id_), refs_(0), pool_(detail::kHeapPool) {}
   virtual ~Event() {}
 
   int id() const { return id_; }
 
+ protected:
+  // Event owned by whoever constructed it rather than by the handles to it.
+  // Handles neither count nor free it, so it must outlive all of them.
+  struct Unmanaged {};
+  Event(int id, Unmanaged) : id_(id), refs_(0), pool_(detail::kStaticPool) {}
+
+  // Handle to an event constructed as Unmanaged
+  EventRef<const Event> ref() const;
+
  private:
+  template <typename T>
+  friend class EventRef;
+  template <typename T, typename... Args>
+  friend EventRef<T> MakeEvent(Args &&... args);
+  template <int Id>
+  friend const EventRef<const Event> &StaticEvent();
+
+  void AddRef() const {
+    if (pool_ == detail::kStaticPool) {
+      return;
+    }
+#ifdef MGPP_EVENTS_SINGLE_THREADED
+    ++refs_;
+#else
+    refs_.fetch_add(1, std::memory_order_relaxed);
+#endif
+  }
+
+  // True when the last reference was dropped. A sole owner needs no RMW,
+  // nobody else holds a reference they could copy.
+  bool DropRef() const {
+#ifdef MGPP_EVENTS_SINGLE_THREADED
+    return --refs_ == 0;
+#else
+    return refs_.load(std::memory_order_acquire) == 1 ||
+           refs_.fetch_sub(1, std::memory_order_acq_rel) == 1;
+#endif
+  }
+
+  // Take the first reference to an event MakeEvent just constructed
+  void Adopt(const unsigned char pool) {
+    pool_ = pool;
+#ifdef MGPP_EVENTS_SINGLE_THREADED
+    refs_ = 1;
+#else
+    refs_.store(1, std::memory_order_relaxed);
+#endif
+  }
+
+  void Release() const {
+    if (pool_ != detail::kStaticPool && DropRef()) {
+      const unsigned char pool = pool_;
+      Event *self = const_cast<Event *>(this);
+      // The block starts at the most derived object, which is not where
+      // the Event is when another base comes first
+      void *block = dynamic_cast<void *>(self);
+      self->~Event();
+      detail::FreeBlock(pool, block);
+    }
+  }
+
   const int id_;
+#ifdef MGPP_EVENTS_SINGLE_THREADED
+  mutable int refs_;
+#else
+  mutable std::atomic<int> refs_;
+#endif
+  unsigned char pool_;  // pool the event's block came from
+};
+
+// Intrusive handle to an event made by MakeEvent, the counterpart of
+// std::shared_ptr for events. Converts to handles of its bases and const.
+template <typename T>
+class EventRef {
+ public:
+  EventRef() : ptr_(nullptr) {}
+  EventRef(std::nullptr_t) : ptr_(nullptr) {}  // NOLINT(runtime/explicit)
+
+  EventRef(const EventRef &other) : ptr_(other.ptr_) { AddRef(); }
+  EventRef(EventRef &&other) : ptr_(other.ptr_) { other.ptr_ = nullptr; }
+
+  template <typename U>
+  EventRef(const EventRef<U> &other)  // NOLINT(runtime/explicit)
+      : ptr_(other.ptr_) {
+    AddRef();
+  }
+
+  template <typename U>
+  EventRef(EventRef<U> &&other)  // NOLINT(runtime/explicit)
+      : ptr_(other.ptr_) {
+    other.ptr_ = nullptr;
+  }
+
+  ~EventRef() {
+    if (ptr_) {
+      static_cast<const Event *>(ptr_)->Release();
+    }
+  }
+
+  EventRef &operator=(EventRef other) {
+    std::swap(ptr_, other.ptr_);
+    return *this;
+  }
+
+  void reset() { EventRef().swap(*this); }
+  void swap(EventRef &other) { std::swap(ptr_, other.ptr_); }
+
+  T *get() const { return ptr_; }
+  T &operator*() const { return *ptr_; }
+  T *operator->() const { return ptr_; }
+  explicit operator bool() const { return ptr_ != nullptr; }
+
+ private:
+  template <typename U>
+  friend class EventRef;
+  template <typename U, typename... Args>
+  friend EventRef<U> MakeEvent(Args &&... args);
+  template <int Id>
+  friend const EventRef<const Event> &StaticEvent();
+  friend class Event;
+
+  // Adopts the reference MakeEvent took
+  explicit EventRef(T *ptr) : ptr_(ptr) {}
+
+  void AddRef() const {
+    if (ptr_) {
+      static_cast<const Event *>(ptr_)->AddRef();
+    }
+  }
+
+  T *ptr_;
+};
+
+inline EventRef<const Event> Event::ref() const {
+  return EventRef<const Event>(this);
+}
+
+template <typename T, typename U>
+bool operator==(const EventRef<T> &lhs, const EventRef<U> &rhs) {
+  return lhs.get() == rhs.get();
+}
+
+template <typename T, typename U>
+bool operator!=(const EventRef<T> &lhs, const EventRef<U> &rhs) {
+  return lhs.get() != rhs.get();
+}
+
+template <typename T>
+bool operator==(const EventRef<T> &lhs, std::nullptr_t) {
+  return !lhs;
+}
+
+template <typename T>
+bool operator!=(const EventRef<T> &lhs, std::nullptr_t) {
+  return static_cast<bool>(lhs);
+}
+
+// Event carrying a payload of type T, constructed in place from the
+// arguments after the id. Passing an rvalue buffer, e.g. a std::vector or
+// std::string, adopts it without copying its contents.
+template <typename T>
+class PayloadEvent : public Event {
+ public:
+  template <typename... Args>
+  explicit PayloadEvent(int id, Args &&... args)
+      : Event(id), payload_(std::forward<Args>(args)...) {}
+
+  const T &payload() const { return payload_; }
+
+ private:
+  T payload_;
 };
 
-using EventPtr = std::shared_ptr<Event>;
-using EventConstPtr = std::shared_ptr<const Event>;
+using EventPtr = EventRef<Event>;
+using EventConstPtr = EventRef<const Event>;
 
+// Events live in a block from the event pools sized for T. The arguments
+// are forwarded to the event's constructor.
 template <typename T, typename... Args>
-std::shared_ptr<T> MakeEvent(Args... args) {
-  return std::make_shared<T>(args...);
+EventRef<T> MakeEvent(Args &&... args) {
+  const std::size_t kBlockSize = detail::BlockSizeOf<T>::value;
+  void *block = detail::Blocks<kBlockSize>::Allocate(sizeof(T), alignof(T));
+  T *event;
+  try {
+    event = new (block) T(std::forward<Args>(args)...);
+  } catch (...) {
+    detail::Blocks<kBlockSize>::Free(block);
+    throw;
+  }
+
+  static_cast<Event *>(event)->Adopt(detail::PoolOf(kBlockSize));
+  return EventRef<T>(event);
+}
+
+// Immortal, payload-free event with the given id, shared by the whole
+// program. It is never counted or freed, so handing it around costs no
+// atomics and making it costs no allocation after the first call.
+template <int Id>
+const EventConstPtr &StaticEvent() {
+  // Placed in storage that is never destroyed, so handles held by other
+  // statics stay valid until exit
+  static typename std::aligned_storage<sizeof(Event), alignof(Event)>::type
+      storage;
+  static const EventConstPtr ref([]() {
+    return EventConstPtr(new (&storage) Event(Id, Event::Unmanaged()));
+  }());
+  return ref;
 }
 
 }  // namespace signals
@@ -0,0 +1,388 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_SIGNALS_EVENT_POOL_HPP_
+#define MGPP_SIGNALS_EVENT_POOL_HPP_
+
+#include <stdlib.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <vector>
+
+#include <mgpp/noncopyable.hpp>
+
+namespace mgpp {
+namespace signals {
+
+struct PoolMetrics {
+  std::size_t block_size;  // bytes per block
+  std::size_t capacity;    // blocks allocated from the heap so far
+  std::size_t in_use;      // blocks currently handed out
+  std::size_t high_water;  // most blocks ever handed out at once
+};
+
+namespace detail {
+
+// Lock-free pool of fixed size blocks shared by all threads.
+//
+// Blocks are carved out of 64 KiB chunks that are aligned to their size, so
+// the chunk, and with it the index, of a block follows from its address.
+// Free blocks form a Treiber stack linked by index, and the stack head packs
+// the top index with a tag bumped on every pop to defeat ABA. The stack's
+// links live in an array beside each chunk rather than in the blocks, since
+// a popper may read the link of a block another thread already popped and
+// is writing an event into. Chunks are never returned to the heap.
+template <std::size_t BlockSize>
+class BlockPool : private Noncopyable {
+ public:
+  static const std::size_t kChunkBytes = 64 * 1024;
+  static const std::size_t kMaxChunks = 4096;
+
+  static_assert(BlockSize >= sizeof(void *) &&
+                    BlockSize % alignof(std::max_align_t) == 0 &&
+                    kChunkBytes % BlockSize == 0,
+                "mgpp::signals: invalid block size");
+
+  BlockPool()
+      : head_(0), num_chunks_(0), capacity_(0), in_use_(0), high_water_(0) {}
+
+  // Pop up to `count` blocks onto the singly linked `list`, growing the pool
+  // if it is empty. Returns the number of blocks popped, at least one.
+  std::size_t Pop(char **list, const std::size_t count);
+
+  // Push `count` blocks from the singly linked `list`
+  void Push(char *list, const std::size_t count);
+
+  PoolMetrics metrics() const;
+
+  // Link of a block on a thread's private list
+  static char *&Link(char *block) { return *reinterpret_cast<char **>(block); }
+
+ private:
+  // The first slot of every chunk holds the chunk's index
+  static const std::uint32_t kChunkSlots = kChunkBytes / BlockSize;
+
+  char *Address(const std::uint32_t index) const {
+    return chunks_[index / kChunkSlots].load(std::memory_order_acquire) +
+           (index % kChunkSlots) * BlockSize;
+  }
+
+  // Link of a block on the shared stack
+  std::atomic<std::uint32_t> *Next(const std::uint32_t index) const {
+    return links_[index / kChunkSlots].load(std::memory_order_acquire) +
+           index % kChunkSlots;
+  }
+
+  static std::uint32_t Index(char *block) {
+    const std::uintptr_t addr = reinterpret_cast<std::uintptr_t>(block);
+    const std::uintptr_t base = addr & ~std::uintptr_t(kChunkBytes - 1);
+    const std::uint32_t chunk = *reinterpret_cast<std::uint32_t *>(base);
+    return chunk * kChunkSlots +
+           static_cast<std::uint32_t>((addr - base) / BlockSize);
+  }
+
+  void PushShared(const std::uint32_t first, const std::uint32_t last);
+  void Grow();
+
+  // Top of the free stack in the low half, 0 when empty, tag in the high half
+  std::atomic<std::uint64_t> head_;
+
+  std::mutex grow_mutex_;
+  std::atomic<char *> chunks_[kMaxChunks];
+  std::atomic<std::atomic<std::uint32_t> *> links_[kMaxChunks];
+  std::uint32_t num_chunks_;
+
+  // Blocks held by threads, in use or cached, count as in use
+  std::atomic<std::size_t> capacity_;
+  std::atomic<std::size_t> in_use_;
+  std::atomic<std::size_t> high_water_;
+};
+
+template <std::size_t BlockSize>
+std::size_t BlockPool<BlockSize>::Pop(char **list, const std::size_t count) {
+  std::size_t popped = 0;
+  std::uint64_t head = head_.load(std::memory_order_acquire);
+  while (popped < count) {
+    const std::uint32_t top = static_cast<std::uint32_t>(head);
+    if (top == 0) {
+      if (popped > 0) {
+        break;
+      }
+      Grow();
+      head = head_.load(std::memory_order_acquire);
+      continue;
+    }
+
+    // The block may be popped and relinked concurrently, in which case the
+    // tag has moved on and the CAS discards whatever was read here
+    const std::uint64_t next = Next(top)->load(std::memory_order_relaxed);
+    const std::uint64_t tag = (head >> 32) + 1;
+    if (head_.compare_exchange_weak(head, (tag << 32) | next,
+                                    std::memory_order_acquire,
+                                    std::memory_order_acquire)) {
+      char *block = Address(top);
+      Link(block) = *list;
+      *list = block;
+      popped++;
+    }
+  }
+
+  const std::size_t in_use = in_use_ += popped;
+  std::size_t high_water = high_water_.load(std::memory_order_relaxed);
+  while (in_use > high_water &&
+         !high_water_.compare_exchange_weak(high_water, in_use)) {
+  }
+  return popped;
+}
+
+template <std::size_t BlockSize>
+void BlockPool<BlockSize>::Push(char *list, const std::size_t count) {
+  // Relink the blocks by index, the form the shared stack uses
+  const std::uint32_t last = Index(list);
+  std::uint32_t first = last;
+  for (char *block = Link(list); block; block = Link(block)) {
+    const std::uint32_t index = Index(block);
+    Next(index)->store(first, std::memory_order_relaxed);
+    first = index;
+  }
+
+  in_use_ -= count;
+  PushShared(first, last);
+}
+
+template <std::size_t BlockSize>
+void BlockPool<BlockSize>::PushShared(const std::uint32_t first,
+                                      const std::uint32_t last) {
+  std::uint64_t head = head_.load(std::memory_order_relaxed);
+  do {
+    Next(last)->store(static_cast<std::uint32_t>(head),
+                      std::memory_order_relaxed);
+  } while (!head_.compare_exchange_weak(
+      head, (head & ~std::uint64_t(0xffffffff)) | first,
+      std::memory_order_release, std::memory_order_relaxed));
+}
+
+template <std::size_t BlockSize>
+void BlockPool<BlockSize>::Grow() {
+  std::lock_guard<std::mutex> lock(grow_mutex_);
+  if (static_cast<std::uint32_t>(head_.load()) != 0) {
+    // Another thread grew the pool, or blocks were freed, meanwhile
+    return;
+  }
+
+  void *memory = nullptr;
+  if (num_chunks_ == kMaxChunks ||
+      posix_memalign(&memory, kChunkBytes, kChunkBytes) != 0) {
+    throw std::bad_alloc();
+  }
+  std::atomic<std::uint32_t> *links;
+  try {
+    links = new std::atomic<std::uint32_t>[kChunkSlots];
+  } catch (...) {
+    free(memory);
+    throw;
+  }
+  char *chunk = static_cast<char *>(memory);
+  *reinterpret_cast<std::uint32_t *>(chunk) = num_chunks_;
+  chunks_[num_chunks_].store(chunk, std::memory_order_release);
+
+  // Link slots 1..kChunkSlots - 1 and push them in one go
+  const std::uint32_t first = num_chunks_ * kChunkSlots + 1;
+  const std::uint32_t last = first + kChunkSlots - 2;
+  for (std::uint32_t slot = 1; slot + 1 < kChunkSlots; ++slot) {
+    links[slot].store(first + slot, std::memory_order_relaxed);
+  }
+  links[kChunkSlots - 1].store(0, std::memory_order_relaxed);
+  links_[num_chunks_].store(links, std::memory_order_release);
+  num_chunks_++;
+  capacity_ += kChunkSlots - 1;
+  PushShared(first, last);
+}
+
+template <std::size_t BlockSize>
+PoolMetrics BlockPool<BlockSize>::metrics() const {
+  PoolMetrics metrics;
+  metrics.block_size = BlockSize;
+  metrics.capacity = capacity_;
+  metrics.in_use = in_use_;
+  metrics.high_water = high_water_;
+  return metrics;
+}
+
+// Pool shared by every event of one size class. Deliberately leaked, so
+// events held in static objects may outlive every other static.
+template <std::size_t BlockSize>
+BlockPool<BlockSize> &Pool() {
+  static BlockPool<BlockSize> *pool = new BlockPool<BlockSize>();
+  return *pool;
+}
+
+// Per-thread list of free blocks in front of the shared pool, so a thread
+// that frees about as many events as it makes never touches an atomic.
+// Blocks move between the two in batches.
+template <std::size_t BlockSize>
+class BlockCache : private Noncopyable {
+ public:
+  static const std::size_t kBatch = 32;
+
+  BlockCache() : list_(nullptr), count_(0) {}
+  ~BlockCache() {
+    if (list_) {
+      Pool<BlockSize>().Push(list_, count_);
+    }
+  }
+
+  void *Allocate() {
+    if (!list_) {
+      count_ = Pool<BlockSize>().Pop(&list_, kBatch);
+    }
+    char *block = list_;
+    list_ = BlockPool<BlockSize>::Link(block);
+    count_--;
+    return block;
+  }
+
+  void Free(void *block) {
+    char *freed = static_cast<char *>(block);
+    BlockPool<BlockSize>::Link(freed) = list_;
+    list_ = freed;
+    if (++count_ == 2 * kBatch) {
+      // Keep one batch, hand the rest back for other threads
+      char *kept = list_;
+      for (std::size_t i = 1; i < kBatch; ++i) {
+        kept = BlockPool<BlockSize>::Link(kept);
+      }
+      char *rest = BlockPool<BlockSize>::Link(kept);
+      BlockPool<BlockSize>::Link(kept) = nullptr;
+      Pool<BlockSize>().Push(rest, kBatch);
+      count_ = kBatch;
+    }
+  }
+
+ private:
+  char *list_;
+  std::size_t count_;
+};
+
+// Smallest size class that fits Size bytes, 0 if none does
+constexpr std::size_t SizeClass(const std::size_t size,
+                                const std::size_t block = 64) {
+  return size <= block ? block : block < 1024 ? SizeClass(size, block * 2) : 0;
+}
+
+// Blocks of one size class. Allocations that fit no size class, or need
+// more than the pools' alignment, go to the heap.
+template <std::size_t BlockSize>
+struct Blocks {
+  static BlockCache<BlockSize> &Cache() {
+    static thread_local BlockCache<BlockSize> cache;
+    return cache;
+  }
+
+  static void *Allocate(std::size_t, std::size_t) {
+    return Cache().Allocate();
+  }
+  static void Free(void *block) { Cache().Free(block); }
+};
+
+// C++11 operator new only guarantees the alignment of std::max_align_t, so
+// heap blocks come from posix_memalign for over-aligned events
+template <>
+struct Blocks<0> {
+  static void *Allocate(std::size_t size, std::size_t alignment) {
+    void *block = nullptr;
+    if (posix_memalign(&block,
+                       alignment < sizeof(void *) ? sizeof(void *) : alignment,
+                       size) != 0) {
+      throw std::bad_alloc();
+    }
+    return block;
+  }
+  static void Free(void *block) { free(block); }
+};
+
+// Size class of the blocks holding a T, 0 when it goes to the heap
+template <typename T>
+struct BlockSizeOf {
+  static const std::size_t value =
+      alignof(T) <= alignof(std::max_align_t) ? SizeClass(sizeof(T)) : 0;
+};
+
+// Pools are numbered 0 to 4 by size class, 64 << pool bytes
+const unsigned char kHeapPool = 5;
+
+// Marks events that are never counted or freed
+const unsigned char kStaticPool = 6;
+
+constexpr unsigned char PoolOf(const std::size_t block_size,
+                               const unsigned char pool = 0) {
+  return block_size == 0 ? kHeapPool
+                         : (std::size_t(64) << pool) == block_size
+                               ? pool
+                               : PoolOf(block_size, pool + 1);
+}
+
+// Return a block to the pool it came from, known only at run time
+inline void FreeBlock(const unsigned char pool, void *block) {
+  switch (pool) {
+    case 0:
+      Blocks<64>::Free(block);
+      break;
+    case 1:
+      Blocks<128>::Free(block);
+      break;
+    case 2:
+      Blocks<256>::Free(block);
+      break;
+    case 3:
+      Blocks<512>::Free(block);
+      break;
+    case 4:
+      Blocks<1024>::Free(block);
+      break;
+    default:
+      Blocks<0>::Free(block);
+      break;
+  }
+}
+
+}  // namespace detail
+
+// Metrics of every event pool, smallest size class first
+inline std::vector<PoolMetrics> EventPoolMetrics() {
+  return {detail::Pool<64>().metrics(), detail::Pool<128>().metrics(),
+          detail::Pool<256>().metrics(), detail::Pool<512>().metrics(),
+          detail::Pool<1024>().metrics()};
+}
+
+}  // namespace signals
+}  // namespace mgpp
+
+#endif  // MGPP_SIGNALS_EVENT_POOL_HPP_
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_SIGNALS_FILTER_HPP_
+#define MGPP_SIGNALS_FILTER_HPP_
+
+#include <functional>
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <utility>
+
+#include <mgpp/signals/event.hpp>
+
+namespace mgpp {
+namespace signals {
+
+// Condition on the content of an event, checked by the dispatcher before
+// calling the slots subscribed with it.
+//
+// Filters with equal keys select the same events, so the dispatcher groups
+// their slots and checks the condition once per event for all of them.
+// Field filters built from the same event type, getter and bounds are equal;
+// predicate filters are only equal to copies of themselves.
+class EventFilter {
+ public:
+  using Predicate = std::function<bool(const Event &)>;
+
+  explicit EventFilter(Predicate predicate)
+      : predicate_(std::make_shared<const Predicate>(std::move(predicate))) {
+    key_ = "p";
+    Append(&key_, predicate_.get());
+  }
+
+  // Events of type T for which `getter` returns a value in [min, max]
+  template <typename T, typename R, typename V>
+  static EventFilter Range(R (T::*getter)() const, const V &min,
+                           const V &max) {
+    static_assert(std::is_base_of<Event, T>::value,
+                  "field filters apply to events");
+    static_assert(std::is_scalar<V>::value, "bounds must be scalars");
+    // Member function pointers do not identify the class on their own,
+    // virtual ones only hold a vtable offset, so the types go in the key too
+    std::string key = "r";
+    AppendType(&key, typeid(T));
+    AppendType(&key, typeid(R));
+    AppendType(&key, typeid(V));
+    Append(&key, getter);
+    Append(&key, min);
+    Append(&key, max);
+    return EventFilter(
+        std::make_shared<const Predicate>([getter, min, max](
+            const Event &event) {
+          const R &value = (static_cast<const T &>(event).*getter)();
+          return !(value < min) && !(max < value);
+        }),
+        std::move(key));
+  }
+
+  // Events of type T for which `getter` returns `value`
+  template <typename T, typename R, typename V>
+  static EventFilter Equal(R (T::*getter)() const, const V &value) {
+    return Range(getter, value, value);
+  }
+
+  bool operator()(const Event &event) const { return (*predicate_)(event); }
+
+  const std::string &key() const { return key_; }
+
+  bool operator==(const EventFilter &other) const {
+    return key_ == other.key_;
+  }
+
+ private:
+  EventFilter(std::shared_ptr<const Predicate> predicate, std::string key)
+      : predicate_(std::move(predicate)), key_(std::move(key)) {}
+
+  template <typename U>
+  static void Append(std::string *key, const U &value) {
+    key->append(reinterpret_cast<const char *>(&value), sizeof(value));
+  }
+
+  static void AppendType(std::string *key, const std::type_info &type) {
+    key->append(type.name());
+    key->push_back('\0');
+  }
+
+  std::shared_ptr<const Predicate> predicate_;
+  std::string key_;
+};
+
+}  // namespace signals
+}  // namespace mgpp
+
+#endif  // MGPP_SIGNALS_FILTER_HPP_
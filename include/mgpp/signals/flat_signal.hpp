@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_SIGNALS_FLAT_SIGNAL_HPP_
+#define MGPP_SIGNALS_FLAT_SIGNAL_HPP_
+
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+#include <mgpp/noncopyable.hpp>
+#include <mgpp/signals/event.hpp>
+
+namespace mgpp {
+namespace signals {
+
+// Forward declarations
+class FlatSignal;
+struct FlatSlotState;
+
+// Handle to a slot connected to a FlatSignal. Mirrors the subset of
+// boost::signals2::connection used by the dispatcher.
+class FlatConnection {
+ public:
+  FlatConnection();
+
+  void disconnect() const;
+  bool connected() const;
+
+ private:
+  friend class FlatSignal;
+  explicit FlatConnection(std::shared_ptr<FlatSlotState> state);
+
+  std::shared_ptr<FlatSlotState> state_;
+};
+
+// Lightweight replacement for
+// boost::signals2::signal<void(const EventConstPtr &)>.
+//
+// Slots are stored in a contiguous array and invoked in connection order.
+// Connecting appends in place until the array is full, disconnecting marks the
+// slot as a tombstone that invocation skips, and the array is compacted on
+// growth or once tombstones outnumber live slots. Invocation never blocks and
+// may run concurrently with connect and disconnect.
+class FlatSignal : private Noncopyable {
+ public:
+  using Slot = std::function<void(const EventConstPtr &)>;
+
+  FlatSignal();
+  ~FlatSignal();
+
+  FlatConnection connect(const Slot &slot);
+  void disconnect_all_slots();
+  bool empty() const;
+  std::size_t num_slots() const;
+
+  void operator()(const EventConstPtr &event) const;
+
+ private:
+  friend struct FlatSlotState;
+  struct Core;
+
+  std::shared_ptr<Core> core_;
+};
+
+}  // namespace signals
+}  // namespace mgpp
+
+#endif  // MGPP_SIGNALS_FLAT_SIGNAL_HPP_
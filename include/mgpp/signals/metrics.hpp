@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_SIGNALS_METRICS_HPP_
+#define MGPP_SIGNALS_METRICS_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <mgpp/noncopyable.hpp>
+
+namespace mgpp {
+namespace signals {
+
+// Lock-free log-linear histogram in the style of HdrHistogram. Values below
+// 16 get a bucket each, larger ones are bucketed by their highest set bit
+// and the three bits below it, so every bucket is within 12.5% of the values
+// it holds.
+class Histogram : private Noncopyable {
+ public:
+  static const std::size_t kBuckets = 16 + 60 * 8;
+
+  Histogram() { Reset(); }
+
+  void Record(const std::uint64_t value) {
+    buckets_[Bucket(value)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    sum_.fetch_add(value, std::memory_order_relaxed);
+    std::uint64_t max = max_.load(std::memory_order_relaxed);
+    while (value > max &&
+           !max_.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+    }
+  }
+
+  std::uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+  std::uint64_t max() const { return max_.load(std::memory_order_relaxed); }
+  double mean() const;
+
+  // Highest value in the bucket holding the given fraction of the values
+  std::uint64_t Percentile(const double fraction) const;
+
+  // Not atomic with respect to concurrent Record calls
+  void Reset();
+
+ private:
+  static std::size_t Bucket(const std::uint64_t value) {
+    if (value < 16) {
+      return static_cast<std::size_t>(value);
+    }
+    const unsigned magnitude = 63 - __builtin_clzll(value);
+    return 16 + (magnitude - 4) * 8 + ((value >> (magnitude - 3)) & 7);
+  }
+
+  static std::uint64_t BucketMax(const std::size_t bucket);
+
+  std::atomic<std::uint64_t> buckets_[kBuckets];
+  std::atomic<std::uint64_t> count_;
+  std::atomic<std::uint64_t> sum_;
+  std::atomic<std::uint64_t> max_;
+};
+
+struct IdMetrics {
+  int id;
+  std::uint64_t publishes;   // events published with this id
+  std::uint64_t slot_calls;  // slots called for them
+  std::uint64_t max_fanout;  // most slots called for one event
+};
+
+struct SlotMetrics {
+  int id;
+  std::size_t slot;  // order in which the slots of the id subscribed
+  std::uint64_t calls;
+  double mean_ns;
+  std::uint64_t p50_ns;
+  std::uint64_t p99_ns;
+  std::uint64_t max_ns;
+};
+
+// Dispatcher metrics, collected only when the library is built with
+// MGPP_SIGNALS_METRICS. Without it Publish carries no instrumentation and
+// these return nothing. Slots are timed from the subscriber's point of view,
+// including anything they publish in turn, and reported until unsubscribed.
+// Each dispatcher keeps its own metrics; these functions report those of the
+// default dispatcher, Dispatcher::Instance().
+std::vector<IdMetrics> DispatcherIdMetrics();
+std::vector<SlotMetrics> DispatcherSlotMetrics();
+
+// One line per id followed by one line per slot, slowest slots first
+void DumpDispatcherMetrics(std::ostream &out);
+
+void ResetDispatcherMetrics();
+
+}  // namespace signals
+}  // namespace mgpp
+
+#endif  // MGPP_SIGNALS_METRICS_HPP_
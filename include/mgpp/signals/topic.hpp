@@ -0,0 +1,87 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_SIGNALS_TOPIC_HPP_
+#define MGPP_SIGNALS_TOPIC_HPP_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <mgpp/signals/dispatcher.hpp>
+
+namespace mgpp {
+namespace signals {
+
+// Hierarchical topics on top of event ids.
+//
+// A topic names an id with levels separated by '/', e.g.
+// "sensor/kitchen/temperature". Patterns select topics level by level:
+// "+" matches any one level and a trailing "#" matches any number of
+// remaining levels, the parent level included, so "sensor/#" matches
+// "sensor" and "sensor/kitchen/temperature" alike.
+//
+// Patterns are resolved against a trie of the registered topics when
+// subscribing, and new topics against the subscribed patterns when
+// registering, connecting the callback to the signal of every matching id.
+// Publishing an event is still a single lookup of its id, whatever the
+// number of patterns matching its topic.
+//
+// Every dispatcher keeps its own topics and pattern subscriptions, see the
+// topic members of Dispatcher. The functions below use the default
+// dispatcher, Dispatcher::Instance().
+
+// Name `id` with `topic`. Registering the same topic again does nothing.
+// Throws std::invalid_argument if the topic is empty, has an empty level or
+// a wildcard, or either the id or the topic is registered already under
+// another name.
+void RegisterTopic(const int id, const std::string &topic);
+
+// Connect `cb` to the ids of every topic matching `pattern`, now or
+// registered later. Throws std::invalid_argument if the pattern has an
+// empty level or a "#" other than as its last level.
+TopicSubscription SubscribeTopic(const std::string &pattern,
+                                 const EventCallback cb);
+
+template <typename T>
+TopicSubscription SubscribeTopic(const std::string &pattern,
+                                 const EventMemberCallback<T> mcb,
+                                 const T &obj) {
+  return SubscribeTopic(pattern, boost::bind(mcb, const_cast<T *>(&obj),
+                                             boost::placeholders::_1));
+}
+
+// Disconnect a pattern subscription from all its ids. UnsubscribeAll()
+// drops every pattern subscription as well.
+void UnsubscribeTopic(const TopicSubscription &subscription);
+
+// Ids of the registered topics matching `pattern`, in ascending order
+std::vector<int> MatchTopic(const std::string &pattern);
+
+}  // namespace signals
+}  // namespace mgpp
+
+#endif  // MGPP_SIGNALS_TOPIC_HPP_
@@ -0,0 +1,228 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <mgpp/ao/active.hpp>
+
+#include <stdexcept>
+#include <utility>
+
+#include <mgpp/ao/kernel.hpp>
+#include <mgpp/ao/scheduler.hpp>
+
+#include "mgpp/wait.hpp"
+
+namespace mgpp {
+namespace ao {
+
+namespace {
+
+// Events dispatched before a scheduled active object yields its worker
+constexpr int kSliceEvents = 32;
+
+}  // namespace
+
+Active::Active(std::unique_ptr<Hsm> hsm, const std::size_t capacity)
+    : Active(std::move(hsm), capacity, nullptr, nullptr, 0) {}
+
+Active::Active(std::unique_ptr<Hsm> hsm, const std::size_t capacity,
+               Scheduler *scheduler)
+    : Active(std::move(hsm), capacity, scheduler, nullptr, 0) {}
+
+Active::Active(std::unique_ptr<Hsm> hsm, const std::size_t capacity,
+               Kernel *kernel, const unsigned priority)
+    : Active(std::move(hsm), capacity, nullptr, kernel, priority) {
+  if (priority == 0 || priority > Kernel::kMaxPriority) {
+    throw std::invalid_argument("mgpp::ao: invalid priority");
+  }
+}
+
+Active::Active(std::unique_ptr<Hsm> hsm, const std::size_t capacity,
+               Scheduler *scheduler, Kernel *kernel, const unsigned priority)
+    : hsm_(std::move(hsm)),
+      queue_(capacity),
+      stop_(false),
+      waiting_(false),
+      scheduler_(scheduler),
+      scheduled_(true),
+      started_(false),
+      kernel_(kernel),
+      priority_(priority) {}
+
+Active::~Active() { Stop(); }
+
+void Active::Start() {
+  hsm_->Init();
+  if (kernel_) {
+    kernel_->Attach(this, priority_);
+    started_ = true;
+    return;
+  }
+  if (!scheduler_) {
+    thread_ = std::thread(&Active::Run, this);
+    return;
+  }
+
+  // Posts made before Start only queued their events, schedule them now
+  started_ = true;
+  Release();
+}
+
+void Active::Stop() {
+  if (kernel_) {
+    if (!started_) {
+      return;
+    }
+    // Only a running kernel can drain the queue, and it cannot while its
+    // own thread is in here, so from a handler or the idle hook detach at
+    // once and leave the rest queued for the next Start
+    while (!kernel_->OnKernelThread() && kernel_->running() &&
+           kernel_->Ready(priority_)) {
+      std::this_thread::yield();
+    }
+    kernel_->Detach(priority_);
+    started_ = false;
+    return;
+  }
+  if (scheduler_) {
+    if (!started_) {
+      return;
+    }
+    // Release notifies under the lock once it finds stop_ set and nothing
+    // left to run
+    std::unique_lock<std::mutex> lock(mutex_);
+    stop_ = true;
+    detail::Wait(&not_empty_, &lock,
+                 [this]() { return !scheduled_ && queue_.size() == 0; });
+    stop_ = false;
+    started_ = false;
+    return;
+  }
+
+  if (!thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  not_empty_.notify_one();
+  thread_.join();
+}
+
+bool Active::Post(EventConstPtr evt) {
+  if (!queue_.TryPush(std::move(evt))) {
+    return false;
+  }
+  if (scheduler_) {
+    // Pairs with the fence in Release, so either the worker sees the event
+    // or this thread sees the active object unscheduled
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (!scheduled_.exchange(true)) {
+      scheduler_->Schedule(this);
+    }
+    return true;
+  }
+  if (kernel_) {
+    // Pairs with the fence in Kernel::Step, as for the scheduler
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    kernel_->MakeReady(priority_);
+    return true;
+  }
+  Wake();
+  return true;
+}
+
+void Active::PostLifo(EventConstPtr evt) { lifo_.push_back(std::move(evt)); }
+
+void Active::Run() {
+  for (;;) {
+    if (DispatchOne()) {
+      continue;
+    }
+
+    // Announce the wait before the last look at the queue. Pairs with the
+    // fence in Wake, so either Wake sees waiting_ and notifies under the
+    // lock, or the predicate sees the event.
+    std::unique_lock<std::mutex> lock(mutex_);
+    waiting_ = true;
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    detail::Wait(&not_empty_, &lock,
+                 [this]() { return stop_ || queue_.size() > 0; });
+    waiting_ = false;
+    if (stop_ && queue_.size() == 0) {
+      return;
+    }
+  }
+}
+
+bool Active::RunSlice() {
+  for (int i = 0; i < kSliceEvents; ++i) {
+    if (!DispatchOne()) {
+      Release();
+      return false;
+    }
+  }
+
+  // Still scheduled, the worker requeues it behind the others
+  return true;
+}
+
+void Active::Release() {
+  // Locked so Stop cannot see the active object idle, and destroy it,
+  // while this is still touching it
+  std::lock_guard<std::mutex> lock(mutex_);
+  scheduled_ = false;
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (queue_.size() > 0 && !scheduled_.exchange(true)) {
+    scheduler_->Schedule(this);
+  } else if (stop_) {
+    not_empty_.notify_all();
+  }
+}
+
+bool Active::DispatchOne() {
+  EventConstPtr evt;
+  if (!lifo_.empty()) {
+    evt = std::move(lifo_.back());
+    lifo_.pop_back();
+  } else if (!queue_.TryPop(&evt)) {
+    return false;
+  }
+
+  hsm_->Dispatch(evt);
+  return true;
+}
+
+void Active::Wake() {
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting_) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    not_empty_.notify_one();
+  }
+}
+
+}  // namespace ao
+}  // namespace mgpp
@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+#include <mgpp/ao/active.hpp>
+#include <mgpp/ao/bus.hpp>
+
+namespace mgpp {
+namespace ao {
+
+const std::size_t Bus::kMaxSubscribers;
+const std::size_t Bus::kWords;
+
+struct Bus::Shared {
+  Shared() : phase(0), dropped(0) {
+    for (std::atomic<Active *> &active : actives) {
+      active.store(nullptr, std::memory_order_relaxed);
+    }
+    in_flight[0].store(0, std::memory_order_relaxed);
+    in_flight[1].store(0, std::memory_order_relaxed);
+  }
+
+  // Multicasts count themselves in the counter of the current phase.
+  // Synchronize flips the phase twice, each time waiting for the counter
+  // left behind to drain, so every multicast that was running when it was
+  // called has finished once it returns. Multicasts only post, they never
+  // run user code, so waiting for them cannot deadlock.
+  unsigned Enter() {
+    for (;;) {
+      const unsigned current = phase.load();
+      in_flight[current].fetch_add(1);
+      if (phase.load() == current) {
+        return current;
+      }
+      in_flight[current].fetch_sub(1);
+    }
+  }
+
+  void Exit(const unsigned entered) { in_flight[entered].fetch_sub(1); }
+
+  void Synchronize() {
+    std::lock_guard<std::mutex> lock(synchronize_mutex);
+    for (int flip = 0; flip < 2; ++flip) {
+      const unsigned previous = phase.load();
+      phase.store(previous ^ 1);
+      while (in_flight[previous].load() != 0) {
+        std::this_thread::yield();
+      }
+    }
+  }
+
+  std::atomic<Active *> actives[kMaxSubscribers];
+  std::atomic<std::size_t> in_flight[2];
+  std::atomic<unsigned> phase;
+  std::mutex synchronize_mutex;
+  std::atomic<std::uint64_t> dropped;
+};
+
+Bus::Bus() : Bus(signals::Dispatcher::Instance()) {}
+
+Bus::Bus(signals::Dispatcher &dispatcher)
+    : dispatcher_(dispatcher), shared_(std::make_shared<Shared>()) {}
+
+Bus::~Bus() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &id : ids_) {
+      if (id.second->connected) {
+        dispatcher_.Unsubscribe(id.first, id.second->connection);
+      }
+      for (std::atomic<std::uint64_t> &word : id.second->mask) {
+        word.store(0, std::memory_order_release);
+      }
+    }
+  }
+  for (std::atomic<Active *> &active : shared_->actives) {
+    active.store(nullptr, std::memory_order_release);
+  }
+
+  // A publish may still be running a slot that was just disconnected
+  shared_->Synchronize();
+}
+
+void Bus::Subscribe(Active *active, const int id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto subscriber = subscribers_.find(active);
+  if (subscriber == subscribers_.end()) {
+    std::size_t bit = 0;
+    while (bit < kMaxSubscribers &&
+           (shared_->actives[bit].load(std::memory_order_relaxed) ||
+            retiring_[bit])) {
+      ++bit;
+    }
+    if (bit == kMaxSubscribers) {
+      throw std::length_error("Bus: too many subscribers");
+    }
+    shared_->actives[bit].store(active, std::memory_order_release);
+    subscriber = subscribers_.emplace(active, Subscriber{bit, 0}).first;
+  }
+
+  std::shared_ptr<Subscribers> &subscribers = ids_[id];
+  if (!subscribers) {
+    subscribers = std::make_shared<Subscribers>();
+    for (std::atomic<std::uint64_t> &word : subscribers->mask) {
+      word.store(0, std::memory_order_relaxed);
+    }
+    subscribers->connected = false;
+  }
+
+  const std::size_t bit = subscriber->second.bit;
+  const std::uint64_t mask = std::uint64_t(1) << (bit % 64);
+  std::atomic<std::uint64_t> &word = subscribers->mask[bit / 64];
+  if (word.load(std::memory_order_relaxed) & mask) {
+    return;
+  }
+  word.fetch_or(mask, std::memory_order_release);
+  ++subscriber->second.ids;
+
+  if (!subscribers->connected) {
+    std::shared_ptr<Shared> shared = shared_;
+    std::shared_ptr<const Subscribers> target = subscribers;
+    subscribers->connection = dispatcher_.Subscribe(
+        id, [shared, target](const EventConstPtr &evt) {
+          Multicast(shared.get(), *target, evt);
+        });
+    subscribers->connected = true;
+  }
+}
+
+void Bus::Unsubscribe(Active *active, const int id) {
+  std::size_t freed = kMaxSubscribers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto subscriber = subscribers_.find(active);
+    auto subscribers = ids_.find(id);
+    if (subscriber == subscribers_.end() || subscribers == ids_.end()) {
+      return;
+    }
+    const std::size_t bit = subscriber->second.bit;
+    if (Clear(subscribers->second.get(), id, subscriber)) {
+      freed = bit;
+    }
+  }
+  Release(freed);
+}
+
+void Bus::UnsubscribeAll(Active *active) {
+  std::size_t freed = kMaxSubscribers;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    auto subscriber = subscribers_.find(active);
+    if (subscriber == subscribers_.end()) {
+      return;
+    }
+    const std::size_t bit = subscriber->second.bit;
+    for (auto &id : ids_) {
+      if (Clear(id.second.get(), id.first, subscriber)) {
+        freed = bit;
+        break;
+      }
+    }
+  }
+  Release(freed);
+}
+
+std::size_t Bus::NumSubscribers(const int id) const {
+  std::lock_guard<std::mutex> lock(mutex_);
+
+  auto subscribers = ids_.find(id);
+  if (subscribers == ids_.end()) {
+    return 0;
+  }
+  std::size_t count = 0;
+  for (const std::atomic<std::uint64_t> &word : subscribers->second->mask) {
+    count += __builtin_popcountll(word.load(std::memory_order_relaxed));
+  }
+  return count;
+}
+
+std::uint64_t Bus::dropped() const {
+  return shared_->dropped.load(std::memory_order_relaxed);
+}
+
+void Bus::Multicast(Shared *shared, const Subscribers &subscribers,
+                    const EventConstPtr &evt) {
+  const unsigned entered = shared->Enter();
+  for (std::size_t word = 0; word < kWords; ++word) {
+    std::uint64_t bits = subscribers.mask[word].load(std::memory_order_acquire);
+    while (bits) {
+      const std::size_t bit = word * 64 + __builtin_ctzll(bits);
+      bits &= bits - 1;
+      Active *active = shared->actives[bit].load(std::memory_order_acquire);
+      if (active && !active->Post(evt)) {
+        shared->dropped.fetch_add(1, std::memory_order_relaxed);
+      }
+    }
+  }
+  shared->Exit(entered);
+}
+
+bool Bus::Clear(Subscribers *subscribers, const int id,
+                std::unordered_map<Active *, Subscriber>::iterator subscriber) {
+  const std::size_t bit = subscriber->second.bit;
+  const std::uint64_t mask = std::uint64_t(1) << (bit % 64);
+  std::atomic<std::uint64_t> &word = subscribers->mask[bit / 64];
+  if (!(word.load(std::memory_order_relaxed) & mask)) {
+    return false;
+  }
+  word.fetch_and(~mask, std::memory_order_release);
+
+  // Drop the dispatcher slot once nobody listens to the id
+  bool empty = true;
+  for (const std::atomic<std::uint64_t> &other : subscribers->mask) {
+    empty = empty && other.load(std::memory_order_relaxed) == 0;
+  }
+  if (empty && subscribers->connected) {
+    dispatcher_.Unsubscribe(id, subscribers->connection);
+    subscribers->connected = false;
+  }
+
+  // Free the active object's bit along with its last subscription. A
+  // publish that read the mask before the bit was cleared may still look
+  // it up, so it is not handed out again until Release.
+  if (--subscriber->second.ids == 0) {
+    shared_->actives[bit].store(nullptr, std::memory_order_release);
+    retiring_.set(bit);
+    subscribers_.erase(subscriber);
+    return true;
+  }
+  return false;
+}
+
+void Bus::Release(const std::size_t bit) {
+  shared_->Synchronize();
+  if (bit != kMaxSubscribers) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    retiring_.reset(bit);
+  }
+}
+
+}  // namespace ao
+}  // namespace mgpp
@@ -25,126 +25,275 @@
  */
 
 #include <algorithm>
-#include <vector>
+#include <cassert>
+#include <cstdint>
+#include <utility>
 
 #include <mgpp/ao/hsm.hpp>
+#include <mgpp/ao/trace.hpp>
 
 namespace mgpp {
 namespace ao {
 
+namespace {
+
+void PushState(StateHandler *states, std::size_t *size, std::size_t capacity,
+               StateHandler state) {
+  assert(*size < capacity && "state nesting exceeds MGPP_HSM_MAX_DEPTH");
+  states[(*size)++] = state;
+}
+
+std::size_t PathSlot(StateHandler state, StateHandler source,
+                     StateHandler target, std::size_t slots) {
+  std::uintptr_t hash = reinterpret_cast<std::uintptr_t>(state);
+  hash = hash * 31 + reinterpret_cast<std::uintptr_t>(source);
+  hash = hash * 31 + reinterpret_cast<std::uintptr_t>(target);
+  return (hash >> 4) % slots;
+}
+
+std::size_t DispatchSlot(StateHandler state, int signal, std::size_t slots) {
+  std::uintptr_t hash = reinterpret_cast<std::uintptr_t>(state);
+  hash = (hash >> 4) * 31 + static_cast<std::uintptr_t>(signal);
+  return hash % slots;
+}
+
+// Compiled out unless MGPP_AO_TRACE is defined
+inline void Trace(TraceRecordType type, const Hsm *me, StateHandler state,
+                  int signal) {
+#ifdef MGPP_AO_TRACE
+  TraceEvent(type, me, state, signal);
+#else
+  (void)type;
+  (void)me;
+  (void)state;
+  (void)signal;
+#endif
+}
+
+}  // namespace
+
+const std::size_t Hsm::kMaxDepth;
+const std::size_t Hsm::kDeferCapacity;
+
 Hsm::Hsm(StateHandler initial)
     : state_(StateCast(Top)),
       temp_(initial),
-      super_evt_(MakeEvent<Event>(SUPER_SIG)),
-      init_evt_(MakeEvent<Event>(INIT_SIG)),
-      entry_evt_(MakeEvent<Event>(ENTRY_SIG)),
-      exit_evt_(MakeEvent<Event>(EXIT_SIG)) {}
+      transitions_(0),
+      deferred_head_(0),
+      deferred_count_(0),
+      recalled_(0) {}
 
 Hsm::~Hsm() = default;
 
 void Hsm::Init() {
   // TODO(mgigli): Verify that Top is super state of initial state
   InitialTransition(temp_);
+  if (recalled_ > 0) {
+    DispatchRecalled();
+  }
 }
 
-void Hsm::Dispatch(EventConstPtr evt) {
+void Hsm::Dispatch(const EventConstPtr &evt) {
+  DispatchEvent(evt);
+  if (recalled_ > 0) {
+    DispatchRecalled();
+  }
+}
+
+std::size_t Hsm::DispatchBatch(const EventConstPtr *events,
+                               std::size_t count) {
+  return DispatchBatch(events, events + count);
+}
+
+void Hsm::DispatchEvent(const EventConstPtr &evt) {
+  Trace(TRACE_DISPATCH, this, state_, evt->id());
+  if (!dispatch_table_) {
+    temp_ = state_;
+    while (temp_(this, evt) == ACTION_SUPER) {
+    }
+    return;
+  }
+
+  DispatchEntry &entry =
+      dispatch_table_[DispatchSlot(state_, evt->id(), kDispatchTableSize)];
+  if (entry.state == state_ && entry.signal == evt->id()) {
+    // Start at the state that handled the signal last time. If it passes
+    // the event up after all, carry on from its super state as usual.
+    temp_ = entry.handler;
+    while (temp_(this, evt) == ACTION_SUPER) {
+    }
+    return;
+  }
+
+  const StateHandler state = state_;
+  StateHandler handler;
   temp_ = state_;
-  while (temp_(this, evt) == ACTION_SUPER) {
+  do {
+    handler = temp_;
+  } while (handler(this, evt) == ACTION_SUPER);
+
+  entry.state = state;
+  entry.signal = evt->id();
+  entry.handler = handler;
+}
+
+void Hsm::DispatchRecalled() {
+  // Events recalled while these run are dispatched in the same loop
+  while (recalled_ > 0) {
+    --recalled_;
+    --deferred_count_;
+    EventConstPtr evt(std::move(deferred_[deferred_head_]));
+    deferred_head_ = (deferred_head_ + 1) % kDeferCapacity;
+    DispatchEvent(evt);
+  }
+}
+
+void Hsm::EnableDispatchTable() {
+  if (!dispatch_table_) {
+    dispatch_table_.reset(new DispatchEntry[kDispatchTableSize]());
   }
 }
 
 StateHandler Hsm::state() const { return state_; }
 
-StateAction Hsm::Top(Hsm *const me, EventConstPtr evt) {
+std::size_t Hsm::deferred() const { return deferred_count_; }
+
+StateAction Hsm::Top(Hsm *const me, const EventConstPtr &evt) {
   (void)me;
   (void)evt;
   return ACTION_IGNORED;
 }
 
 void Hsm::EnterState(StateHandler state) {
-  state(this, entry_evt_);
+  Trace(TRACE_ENTRY, this, state, ENTRY_SIG);
+  state(this, StaticEvent<ENTRY_SIG>());
   state_ = StateCast(state);
 }
 
-void Hsm::ExitState() {
-  state_(this, exit_evt_);
-  state_(this, super_evt_);
-  state_ = temp_;
-}
-
 StateAction Hsm::InitialTransition(StateHandler target) {
+  Trace(TRACE_INIT, this, target, -1);
+
   // Record hierarchy of the target state.
-  std::vector<StateHandler> target_hierarchy;
-  target_hierarchy.push_back(target);
+  StateHandler target_hierarchy[kMaxDepth];
+  std::size_t depth = 0;
+  PushState(target_hierarchy, &depth, kMaxDepth, target);
   temp_ = target;
-  while (temp_(this, super_evt_) != ACTION_IGNORED && temp_ != state_) {
-    target_hierarchy.push_back(temp_);
+  while (temp_(this, StaticEvent<SUPER_SIG>()) != ACTION_IGNORED &&
+         temp_ != state_) {
+    PushState(target_hierarchy, &depth, kMaxDepth, temp_);
   }
 
   // Enter each state in the hierarchy, including the target
-  for (auto iter = target_hierarchy.rbegin(); iter != target_hierarchy.rend();
-       ++iter) {
-    EnterState(*iter);
+  while (depth > 0) {
+    EnterState(target_hierarchy[--depth]);
   }
 
   // Perform initial transition on target
-  return target(this, init_evt_);
+  return target(this, StaticEvent<INIT_SIG>());
 }
 
-bool StateInHierarchy(StateHandler state,
-                      const std::vector<StateHandler> &hierarchy) {
-  return (std::find(hierarchy.begin(), hierarchy.end(), state) !=
-          hierarchy.end());
+Hsm::TransitionPath &Hsm::CachedPath(StateHandler state, StateHandler source,
+                                     StateHandler target) {
+  // Trivially constructible, so zero initialized without a guard
+  static thread_local TransitionPath paths[kPathCacheSize];
+  return paths[PathSlot(state, source, target, kPathCacheSize)];
 }
 
-StateAction Hsm::Transition(StateHandler target) {
-  // temp_ is pointing to the state that handled the event that caused
-  // the transition (aka the source state). Record for later use.
-  StateHandler source = temp_;
+StateHandler Hsm::SuperOf(StateHandler state) {
+  temp_ = state;
+  state(this, StaticEvent<SUPER_SIG>());
+  return temp_;
+}
+
+void Hsm::FindPath(StateHandler source, StateHandler target,
+                   TransitionPath *path) {
+  const std::size_t capacity = 2 * kMaxDepth;
+  path->state = state_;
+  path->source = source;
+  path->target = target;
+  path->length = 0;
 
-  while (source != state_) {
-    // Exit states from current state up to transition source.
-    ExitState();
+  // Exit states from current state up to transition source.
+  StateHandler state = state_;
+  while (state != source) {
+    PushState(path->path, &path->length, capacity, state);
+    state = SuperOf(state);
   }
 
   if (target == source) {
     // Check an easy to detect transition: transition to self.
     // We can exit the source state and enter the target state..
-    ExitState();
-    EnterState(target);
-  } else {
-    // Record hierarchy of the target state.
-    std::vector<StateHandler> target_hierarchy;
-    target_hierarchy.push_back(target);
-    temp_ = target;
-    while (temp_(this, super_evt_) != ACTION_IGNORED) {
-      target_hierarchy.push_back(temp_);
-    }
+    PushState(path->path, &path->length, capacity, source);
+    path->common = SuperOf(source);
+    path->exits = path->length;
+    PushState(path->path, &path->length, capacity, target);
+    return;
+  }
 
-    // Find the least common ancestor (LCA) state of the target and the
-    // source states by traversing the source hierarchy until we are in a
-    // state in the target hierarchy.
-    while (!StateInHierarchy(state_, target_hierarchy)) {
-      // Exit until we reach a state in the target hierarchy.
-      // Note that the Top state is at the top of the hierarchy.
-      ExitState();
-    }
+  // Record hierarchy of the target state, Top included.
+  StateHandler target_hierarchy[kMaxDepth + 1];
+  std::size_t depth = 0;
+  PushState(target_hierarchy, &depth, kMaxDepth + 1, target);
+  temp_ = target;
+  while (temp_(this, StaticEvent<SUPER_SIG>()) != ACTION_IGNORED) {
+    PushState(target_hierarchy, &depth, kMaxDepth + 1, temp_);
+  }
 
-    if (state_ != target) {
-      // Drill down into the target state, entering all the states in the
-      // hierarchy along the way, skipping the current state.
-      // Note that we need to traverse the target hierarchy in reverse.
-      for (auto iter = std::find(target_hierarchy.rbegin(),
-                                 target_hierarchy.rend(), state_) +
-                       1;
-           iter != target_hierarchy.rend(); ++iter) {
-        EnterState(*iter);
-      }
-    }
+  // Find the least common ancestor (LCA) state of the target and the
+  // source states by traversing the source hierarchy until we are in a
+  // state in the target hierarchy.
+  // Note that the Top state is at the top of the hierarchy.
+  StateHandler *lca;
+  while ((lca = std::find(target_hierarchy, target_hierarchy + depth,
+                          state)) == target_hierarchy + depth) {
+    PushState(path->path, &path->length, capacity, state);
+    state = SuperOf(state);
   }
+  path->common = state;
+  path->exits = path->length;
+
+  // Drill down into the target state, entering all the states in the
+  // hierarchy below the LCA. Note that we need to traverse the target
+  // hierarchy in reverse. Nothing is entered if the target is the LCA.
+  while (lca != target_hierarchy) {
+    PushState(path->path, &path->length, capacity, *--lca);
+  }
+}
+
+StateAction Hsm::Transition(StateHandler target) {
+  // temp_ is pointing to the state that handled the event that caused
+  // the transition (aka the source state).
+  StateHandler source = temp_;
+
+  TransitionPath &cached = CachedPath(state_, source, target);
+  if (cached.state != state_ || cached.source != source ||
+      cached.target != target) {
+    FindPath(source, target, &cached);
+  }
+
+  // Replay from a copy, exit and entry actions may dispatch other machines
+  // on this thread whose transitions evict the cached entry
+  StateHandler path[2 * kMaxDepth];
+  const std::size_t exits = cached.exits;
+  const std::size_t length = cached.length;
+  const StateHandler common = cached.common;
+  std::copy(cached.path, cached.path + length, path);
+
+  Trace(TRACE_TRANSITION, this, target, -1);
+  for (std::size_t i = 0; i < exits; ++i) {
+    state_ = path[i];
+    Trace(TRACE_EXIT, this, state_, EXIT_SIG);
+    state_(this, StaticEvent<EXIT_SIG>());
+  }
+  state_ = common;
+  for (std::size_t i = exits; i < length; ++i) {
+    EnterState(path[i]);
+  }
+
+  ++transitions_;
 
   // Perform initial transition on target
-  target(this, init_evt_);
+  target(this, StaticEvent<INIT_SIG>());
 
   return ACTION_TRANSITION;
 }
@@ -156,5 +305,22 @@ StateAction Hsm::Super(StateHandler state) {
 
 StateAction Hsm::Handled() { return ACTION_HANDLED; }
 
+bool Hsm::Defer(const EventConstPtr &evt) {
+  if (deferred_count_ == kDeferCapacity) {
+    return false;
+  }
+  deferred_[(deferred_head_ + deferred_count_) % kDeferCapacity] = evt;
+  ++deferred_count_;
+  return true;
+}
+
+bool Hsm::Recall() {
+  if (recalled_ == deferred_count_) {
+    return false;
+  }
+  ++recalled_;
+  return true;
+}
+
 }  // namespace ao
 }  // namespace mgpp
@@ -0,0 +1,168 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <mgpp/ao/kernel.hpp>
+
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include <mgpp/ao/active.hpp>
+
+#include "mgpp/wait.hpp"
+
+namespace mgpp {
+namespace ao {
+
+namespace {
+
+std::uint64_t Bit(const unsigned index) { return std::uint64_t(1) << index; }
+
+// Index of the most significant set bit of a non-zero ready set
+unsigned Highest(const std::uint64_t ready) {
+  return 63 - static_cast<unsigned>(__builtin_clzll(ready));
+}
+
+// Kernel whose Run the calling thread is in, if any
+thread_local Kernel *running_kernel = nullptr;
+
+}  // namespace
+
+const unsigned Kernel::kMaxPriority;
+
+Kernel::Kernel(std::function<void()> idle)
+    : idle_(std::move(idle)),
+      ready_(0),
+      current_(nullptr),
+      running_(false),
+      stop_(false),
+      waiting_(false) {
+  for (auto &active : actives_) {
+    active.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+Kernel::~Kernel() = default;
+
+void Kernel::Run() {
+  Kernel *const outer = running_kernel;
+  running_kernel = this;
+  running_ = true;
+  while (!stop_) {
+    const std::uint64_t ready = ready_.load(std::memory_order_acquire);
+    if (ready == 0) {
+      Idle();
+    } else {
+      Step(Highest(ready));
+    }
+  }
+  stop_ = false;
+  running_ = false;
+  running_kernel = outer;
+}
+
+void Kernel::Stop() {
+  stop_ = true;
+  std::lock_guard<std::mutex> lock(mutex_);
+  not_empty_.notify_one();
+}
+
+void Kernel::Attach(Active *active, const unsigned priority) {
+  Active *expected = nullptr;
+  if (!actives_[priority - 1].compare_exchange_strong(expected, active)) {
+    throw std::invalid_argument("mgpp::ao: priority already in use");
+  }
+
+  // Events may have been posted before the active object was attached
+  MakeReady(priority);
+}
+
+void Kernel::Detach(const unsigned priority) {
+  Active *active = actives_[priority - 1].exchange(nullptr);
+  // On the kernel thread the step in progress, if any, is the caller's own
+  if (OnKernelThread()) {
+    return;
+  }
+  while (current_ == active) {
+    std::this_thread::yield();
+  }
+}
+
+void Kernel::MakeReady(const unsigned priority) {
+  ready_.fetch_or(Bit(priority - 1));
+  if (waiting_) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    not_empty_.notify_one();
+  }
+}
+
+bool Kernel::Ready(const unsigned priority) const {
+  return (ready_ & Bit(priority - 1)) != 0;
+}
+
+bool Kernel::OnKernelThread() const { return running_kernel == this; }
+
+void Kernel::Step(const unsigned index) {
+  Active *active = actives_[index].load();
+  current_ = active;
+
+  // Recheck after publishing current_, so Detach either sees this step or
+  // this step sees the slot emptied
+  if (active && actives_[index].load() == active) {
+    if (!active->DispatchOne()) {
+      ready_.fetch_and(~Bit(index));
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (active->queue_.size() > 0) {
+        ready_.fetch_or(Bit(index));
+      }
+    }
+  } else if (!active) {
+    // Posted to before Start, Attach marks it ready again
+    ready_.fetch_and(~Bit(index));
+    if (actives_[index].load()) {
+      ready_.fetch_or(Bit(index));
+    }
+  }
+  current_ = nullptr;
+}
+
+void Kernel::Idle() {
+  if (idle_) {
+    idle_();
+    return;
+  }
+
+  // ready_ and waiting_ are only accessed with seq_cst operations, so
+  // either MakeReady sees the kernel waiting and notifies under the lock,
+  // or the predicate sees the ready bit
+  std::unique_lock<std::mutex> lock(mutex_);
+  waiting_ = true;
+  detail::Wait(&not_empty_, &lock, [this]() { return stop_ || ready_ != 0; });
+  waiting_ = false;
+}
+
+}  // namespace ao
+}  // namespace mgpp
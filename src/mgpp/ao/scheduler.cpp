@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <mgpp/ao/scheduler.hpp>
+
+#include <deque>
+#include <stdexcept>
+
+#include <mgpp/ao/active.hpp>
+
+#include "mgpp/wait.hpp"
+
+namespace mgpp {
+namespace ao {
+
+namespace {
+
+// Worker the calling thread belongs to, if any
+thread_local const Scheduler *current_scheduler = nullptr;
+thread_local std::size_t current_worker = 0;
+
+}  // namespace
+
+struct Scheduler::Worker {
+  std::mutex mutex;
+  std::deque<Active *> deque;
+};
+
+Scheduler::Scheduler(const std::size_t workers)
+    : next_worker_(0), queued_(0), stop_(false), sleepers_(0) {
+  if (workers == 0) {
+    throw std::invalid_argument("mgpp::ao: invalid number of workers");
+  }
+
+  // Every deque must exist before any worker starts stealing
+  for (std::size_t i = 0; i < workers; ++i) {
+    workers_.emplace_back(new Worker());
+  }
+  for (std::size_t i = 0; i < workers; ++i) {
+    threads_.emplace_back(&Scheduler::Run, this, i);
+  }
+}
+
+Scheduler::~Scheduler() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  not_empty_.notify_all();
+  for (auto &thread : threads_) {
+    thread.join();
+  }
+}
+
+void Scheduler::Schedule(Active *active) {
+  // Posts from a handler stay on the posting worker, others are spread
+  // round-robin
+  if (current_scheduler == this) {
+    Push(current_worker, active, false);
+  } else {
+    Push(next_worker_++ % workers_.size(), active, false);
+  }
+}
+
+void Scheduler::Run(const std::size_t index) {
+  current_scheduler = this;
+  current_worker = index;
+
+  for (;;) {
+    Active *active;
+    if (Pop(index, &active) || Steal(index, &active)) {
+      if (active->RunSlice()) {
+        // Used up its slice, let the rest of the deque go first
+        Push(index, active, true);
+      }
+      continue;
+    }
+
+    // sleepers_ and queued_ are only updated with seq_cst operations, so
+    // either Push sees this worker asleep and notifies under the lock, or
+    // the predicate sees the queued active object
+    std::unique_lock<std::mutex> lock(mutex_);
+    sleepers_++;
+    detail::Wait(&not_empty_, &lock,
+                 [this]() { return stop_ || queued_ > 0; });
+    sleepers_--;
+    if (stop_ && queued_ == 0) {
+      return;
+    }
+  }
+}
+
+void Scheduler::Push(const std::size_t index, Active *active,
+                     const bool front) {
+  Worker &worker = *workers_[index];
+  {
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    if (front) {
+      worker.deque.push_front(active);
+    } else {
+      worker.deque.push_back(active);
+    }
+  }
+  queued_++;
+
+  if (sleepers_ > 0) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    not_empty_.notify_one();
+  }
+}
+
+bool Scheduler::Pop(const std::size_t index, Active **active) {
+  Worker &worker = *workers_[index];
+  std::lock_guard<std::mutex> lock(worker.mutex);
+  if (worker.deque.empty()) {
+    return false;
+  }
+  *active = worker.deque.back();
+  worker.deque.pop_back();
+  queued_--;
+  return true;
+}
+
+bool Scheduler::Steal(const std::size_t thief, Active **active) {
+  if (queued_ == 0) {
+    return false;
+  }
+
+  for (std::size_t i = 1; i < workers_.size(); ++i) {
+    Worker &victim = *workers_[(thief + i) % workers_.size()];
+    std::unique_lock<std::mutex> lock(victim.mutex, std::try_to_lock);
+    if (!lock.owns_lock() || victim.deque.empty()) {
+      continue;
+    }
+    *active = victim.deque.front();
+    victim.deque.pop_front();
+    queued_--;
+    return true;
+  }
+  return false;
+}
+
+}  // namespace ao
+}  // namespace mgpp
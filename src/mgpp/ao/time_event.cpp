@@ -0,0 +1,207 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <mgpp/ao/active.hpp>
+#include <mgpp/ao/time_event.hpp>
+
+namespace mgpp {
+namespace ao {
+
+const unsigned TimerWheel::kLevels;
+const unsigned TimerWheel::kSlotBits;
+const unsigned TimerWheel::kSlots;
+
+TimerWheel::TimerWheel() : now_(0), slots_(), stop_(false) {}
+
+TimerWheel::~TimerWheel() { Stop(); }
+
+void TimerWheel::Tick() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ++now_;
+
+  // Each time a level wraps, spread the next slot of the level above it
+  // over the levels below
+  const unsigned index = now_ & (kSlots - 1);
+  if (index == 0) {
+    for (unsigned level = 1; level < kLevels; ++level) {
+      Cascade(level);
+      if (((now_ >> (kSlotBits * level)) & (kSlots - 1)) != 0) {
+        break;
+      }
+    }
+  }
+
+  TimeEvent *event = slots_[0][index];
+  slots_[0][index] = nullptr;
+  while (event) {
+    TimeEvent *next = event->next_;
+    event->slot_ = nullptr;
+    event->target_->Post(event->ref());
+    if (event->interval_ > 0) {
+      event->expiry_ = now_ + event->interval_;
+      Insert(event);
+    }
+    event = next;
+  }
+}
+
+void TimerWheel::Start(std::chrono::nanoseconds period) {
+  Stop();
+  stop_ = false;
+  thread_ = std::thread([this, period]() {
+    std::chrono::steady_clock::time_point next =
+        std::chrono::steady_clock::now();
+    std::unique_lock<std::mutex> lock(thread_mutex_);
+    for (;;) {
+      // Tick at fixed points in time so that late wakeups don't add up
+      next += period;
+      if (stopped_.wait_until(lock, next, [this]() { return stop_; })) {
+        return;
+      }
+      Tick();
+    }
+  });
+}
+
+void TimerWheel::Stop() {
+  {
+    std::lock_guard<std::mutex> lock(thread_mutex_);
+    stop_ = true;
+  }
+  stopped_.notify_all();
+  if (thread_.joinable()) {
+    thread_.join();
+  }
+}
+
+std::uint64_t TimerWheel::now() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return now_;
+}
+
+void TimerWheel::Insert(TimeEvent *event) {
+  const std::uint64_t delta = event->expiry_ - now_;
+  std::uint64_t expiry = event->expiry_;
+  unsigned level = 0;
+  while (level < kLevels - 1 &&
+         delta >= (std::uint64_t(1) << (kSlotBits * (level + 1)))) {
+    ++level;
+  }
+  if (level == kLevels - 1) {
+    // Park timeouts beyond the wheel's range in its furthest slot, they
+    // are placed again as that slot cascades
+    const std::uint64_t range = std::uint64_t(1) << (kSlotBits * kLevels);
+    if (delta >= range) {
+      expiry = now_ + range - 1;
+    }
+  }
+
+  TimeEvent **slot =
+      &slots_[level][(expiry >> (kSlotBits * level)) & (kSlots - 1)];
+  event->slot_ = slot;
+  event->prev_ = nullptr;
+  event->next_ = *slot;
+  if (*slot) {
+    (*slot)->prev_ = event;
+  }
+  *slot = event;
+}
+
+void TimerWheel::Remove(TimeEvent *event) {
+  if (event->prev_) {
+    event->prev_->next_ = event->next_;
+  } else {
+    *event->slot_ = event->next_;
+  }
+  if (event->next_) {
+    event->next_->prev_ = event->prev_;
+  }
+  event->slot_ = nullptr;
+  event->next_ = nullptr;
+  event->prev_ = nullptr;
+}
+
+void TimerWheel::Cascade(unsigned level) {
+  TimeEvent **slot =
+      &slots_[level][(now_ >> (kSlotBits * level)) & (kSlots - 1)];
+  TimeEvent *event = *slot;
+  *slot = nullptr;
+  while (event) {
+    TimeEvent *next = event->next_;
+    Insert(event);
+    event = next;
+  }
+}
+
+TimeEvent::TimeEvent(int id, Active *target, TimerWheel *wheel)
+    : Event(id, Unmanaged()),
+      target_(target),
+      wheel_(wheel),
+      expiry_(0),
+      interval_(0),
+      slot_(nullptr),
+      next_(nullptr),
+      prev_(nullptr) {}
+
+TimeEvent::~TimeEvent() { Disarm(); }
+
+void TimeEvent::Arm(std::uint64_t ticks, std::uint64_t interval) {
+  std::lock_guard<std::mutex> lock(wheel_->mutex_);
+  if (slot_) {
+    wheel_->Remove(this);
+  }
+  expiry_ = wheel_->now_ + (ticks > 0 ? ticks : 1);
+  interval_ = interval;
+  wheel_->Insert(this);
+}
+
+bool TimeEvent::Disarm() {
+  std::lock_guard<std::mutex> lock(wheel_->mutex_);
+  if (!slot_) {
+    return false;
+  }
+  wheel_->Remove(this);
+  return true;
+}
+
+bool TimeEvent::Rearm(std::uint64_t ticks) {
+  std::lock_guard<std::mutex> lock(wheel_->mutex_);
+  const bool armed = slot_ != nullptr;
+  if (armed) {
+    wheel_->Remove(this);
+  }
+  expiry_ = wheel_->now_ + (ticks > 0 ? ticks : 1);
+  wheel_->Insert(this);
+  return armed;
+}
+
+bool TimeEvent::armed() const {
+  std::lock_guard<std::mutex> lock(wheel_->mutex_);
+  return slot_ != nullptr;
+}
+
+}  // namespace ao
+}  // namespace mgpp
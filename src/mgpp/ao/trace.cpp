@@ -0,0 +1,286 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <mgpp/ao/trace.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <system_error>
+
+namespace mgpp {
+namespace ao {
+
+namespace {
+
+const std::size_t kBufferSize = MGPP_AO_TRACE_BUFFER;
+
+static_assert((kBufferSize & (kBufferSize - 1)) == 0,
+              "MGPP_AO_TRACE_BUFFER must be a power of two");
+
+const char kMagic[8] = {'M', 'G', 'P', 'P', 'T', 'R', 'C', '\0'};
+const std::uint32_t kVersion = 1;
+
+// Single producer, single consumer ring. The owning thread writes at
+// `head`, DrainTrace reads at `tail` with the registry locked. Padding
+// keeps the two counters on separate cache lines.
+struct TraceBuffer {
+  explicit TraceBuffer(const std::uint16_t thread)
+      : head(0), tail(0), dropped(0), retired(false), thread(thread) {}
+
+  std::atomic<std::uint64_t> head;
+  char pad0[64 - sizeof(std::atomic<std::uint64_t>)];
+  std::atomic<std::uint64_t> tail;
+  char pad1[64 - sizeof(std::atomic<std::uint64_t>)];
+  std::atomic<std::uint64_t> dropped;
+  std::atomic<bool> retired;  // owner has exited
+  const std::uint16_t thread;
+  TraceRecord records[kBufferSize];
+};
+
+class Registry {
+ public:
+  Registry() : threads_(0), dropped_(0) {}
+
+  std::shared_ptr<TraceBuffer> Add() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    buffers_.push_back(std::make_shared<TraceBuffer>(
+        static_cast<std::uint16_t>(threads_++)));
+    return buffers_.back();
+  }
+
+  std::size_t Drain(TraceRecord *out, const std::size_t max) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::size_t count = 0;
+    for (auto it = buffers_.begin(); it != buffers_.end();) {
+      TraceBuffer &buffer = **it;
+      std::uint64_t tail = buffer.tail.load(std::memory_order_relaxed);
+      const std::uint64_t head = buffer.head.load(std::memory_order_acquire);
+      for (; tail != head && count < max; ++tail) {
+        out[count++] = buffer.records[tail % kBufferSize];
+      }
+      buffer.tail.store(tail, std::memory_order_release);
+
+      if (tail == head && buffer.retired.load(std::memory_order_acquire)) {
+        dropped_ += buffer.dropped.load(std::memory_order_relaxed);
+        it = buffers_.erase(it);
+      } else {
+        ++it;
+      }
+    }
+    return count;
+  }
+
+  std::uint64_t Dropped() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::uint64_t dropped = dropped_;
+    for (const auto &buffer : buffers_) {
+      dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+    return dropped;
+  }
+
+ private:
+  std::mutex mutex_;
+  std::vector<std::shared_ptr<TraceBuffer>> buffers_;
+  unsigned threads_;
+  std::uint64_t dropped_;  // by threads whose buffers are gone
+};
+
+Registry &Buffers() {
+  static Registry *registry = new Registry();
+  return *registry;
+}
+
+// Keeps the thread's buffer registered until it is drained, even after
+// the thread exits
+struct BufferOwner {
+  ~BufferOwner() {
+    if (buffer) {
+      buffer->retired.store(true, std::memory_order_release);
+    }
+  }
+
+  std::shared_ptr<TraceBuffer> buffer;
+};
+
+thread_local TraceBuffer *local_buffer = nullptr;
+
+TraceBuffer *AddThread() {
+  static thread_local BufferOwner owner;
+  owner.buffer = Buffers().Add();
+  local_buffer = owner.buffer.get();
+  return local_buffer;
+}
+
+}  // namespace
+
+struct TraceFile::Header {
+  char magic[8];
+  std::uint32_t version;
+  std::uint32_t record_size;
+  std::uint64_t count;
+};
+
+void TraceEvent(const TraceRecordType type, const void *object,
+                const StateHandler state, const int signal) {
+  TraceBuffer *buffer = local_buffer;
+  if (buffer == nullptr) {
+    buffer = AddThread();
+  }
+
+  const std::uint64_t head = buffer->head.load(std::memory_order_relaxed);
+  if (head - buffer->tail.load(std::memory_order_acquire) == kBufferSize) {
+    buffer->dropped.store(
+        buffer->dropped.load(std::memory_order_relaxed) + 1,
+        std::memory_order_relaxed);
+    return;
+  }
+
+  TraceRecord &record = buffer->records[head % kBufferSize];
+  record.timestamp = static_cast<std::uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now().time_since_epoch())
+          .count());
+  record.object = reinterpret_cast<std::uintptr_t>(object);
+  record.state = reinterpret_cast<std::uintptr_t>(state);
+  record.signal = signal;
+  record.type = static_cast<std::uint16_t>(type);
+  record.thread = buffer->thread;
+  buffer->head.store(head + 1, std::memory_order_release);
+}
+
+std::size_t DrainTrace(TraceRecord *out, const std::size_t max) {
+  return Buffers().Drain(out, max);
+}
+
+std::uint64_t TraceDropped() { return Buffers().Dropped(); }
+
+TraceFile::TraceFile(const std::string &path, const std::size_t capacity)
+    : fd_(-1),
+      map_(MAP_FAILED),
+      map_size_(sizeof(Header) + capacity * sizeof(TraceRecord)),
+      header_(nullptr),
+      records_(nullptr),
+      capacity_(capacity) {
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0) {
+    throw std::system_error(errno, std::system_category(),
+                            "mgpp::ao: cannot create " + path);
+  }
+
+  // Allocate the blocks up front rather than leaving the file sparse, which
+  // could run out of space while records are written through the mapping
+  // and raise SIGBUS
+  const int error = ::posix_fallocate(fd_, 0, static_cast<off_t>(map_size_));
+  if (error != 0) {
+    ::close(fd_);
+    throw std::system_error(error, std::system_category(),
+                            "mgpp::ao: cannot allocate " + path);
+  }
+
+  map_ = ::mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_,
+                0);
+  if (map_ == MAP_FAILED) {
+    const int error = errno;
+    ::close(fd_);
+    throw std::system_error(error, std::system_category(),
+                            "mgpp::ao: cannot map " + path);
+  }
+
+  header_ = static_cast<Header *>(map_);
+  std::memcpy(header_->magic, kMagic, sizeof(kMagic));
+  header_->version = kVersion;
+  header_->record_size = sizeof(TraceRecord);
+  header_->count = 0;
+  records_ = reinterpret_cast<TraceRecord *>(header_ + 1);
+}
+
+TraceFile::~TraceFile() {
+  const std::size_t used = sizeof(Header) + size() * sizeof(TraceRecord);
+  ::munmap(map_, map_size_);
+
+  // Trimming the unused tail is best effort, readers go by the header count
+  const int trimmed = ::ftruncate(fd_, static_cast<off_t>(used));
+  static_cast<void>(trimmed);
+  ::close(fd_);
+}
+
+std::size_t TraceFile::Flush() {
+  const std::size_t count =
+      DrainTrace(records_ + header_->count, capacity_ - header_->count);
+  header_->count += count;
+  return count;
+}
+
+std::size_t TraceFile::size() const { return header_->count; }
+
+std::size_t TraceFile::capacity() const { return capacity_; }
+
+std::vector<TraceRecord> ReadTrace(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) {
+    throw std::runtime_error("mgpp::ao: cannot open " + path);
+  }
+
+  char magic[sizeof(kMagic)];
+  std::uint32_t version;
+  std::uint32_t record_size;
+  std::uint64_t count;
+  in.read(magic, sizeof(magic));
+  in.read(reinterpret_cast<char *>(&version), sizeof(version));
+  in.read(reinterpret_cast<char *>(&record_size), sizeof(record_size));
+  in.read(reinterpret_cast<char *>(&count), sizeof(count));
+  if (!in || std::memcmp(magic, kMagic, sizeof(kMagic)) != 0 ||
+      version != kVersion || record_size != sizeof(TraceRecord)) {
+    throw std::runtime_error("mgpp::ao: not a trace file: " + path);
+  }
+
+  std::vector<TraceRecord> records;
+  TraceRecord record;
+  while (records.size() < count &&
+         in.read(reinterpret_cast<char *>(&record), sizeof(record))) {
+    records.push_back(record);
+  }
+  if (records.size() < count) {
+    throw std::runtime_error("mgpp::ao: truncated trace file: " + path);
+  }
+  return records;
+}
+
+}  // namespace ao
+}  // namespace mgpp
@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <mgpp/signals/async_dispatcher.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+
+#include <mgpp/mpmc_queue.hpp>
+
+#include "mgpp/signals/epoch.hpp"
+#include "mgpp/wait.hpp"
+
+namespace mgpp {
+namespace signals {
+
+namespace {
+
+// One bit per worker in a route's worker mask
+constexpr std::size_t kMaxWorkers = 64;
+
+using EventSignalPtr = std::shared_ptr<EventSignal>;
+
+}  // namespace
+
+// Subscribers of one id, indexed by the worker they are pinned to
+struct AsyncRoute {
+  std::uint64_t workers;
+  std::vector<EventSignalPtr> signals;
+};
+
+// Copy-on-write id to route table, read under an epoch guard like the
+// synchronous dispatcher's table.
+struct AsyncDispatcher::RouteTable {
+  std::unordered_map<int, AsyncRoute> routes;
+};
+
+class AsyncDispatcher::Worker : private Noncopyable {
+ public:
+  Worker(AsyncDispatcher *owner, const std::size_t index,
+         const std::size_t capacity)
+      : owner_(owner),
+        index_(index),
+        queue_(capacity),
+        stop_(false),
+        consumer_waiting_(false),
+        producers_waiting_(0),
+        high_water_(0),
+        queued_(0),
+        delivered_(0),
+        evicted_(0),
+        rejected_(0),
+        thread_(&Worker::Run, this) {}
+
+  ~Worker() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    not_empty_.notify_one();
+    thread_.join();
+  }
+
+  bool Push(const EventConstPtr &event, const Backpressure policy) {
+    for (;;) {
+      if (queue_.TryPush(event)) {
+        queued_++;
+        UpdateHighWater();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (consumer_waiting_) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          not_empty_.notify_one();
+        }
+        return true;
+      }
+
+      switch (policy) {
+        case BACKPRESSURE_DROP_NEWEST:
+          rejected_++;
+          return false;
+        case BACKPRESSURE_DROP_OLDEST: {
+          EventConstPtr oldest;
+          if (queue_.TryPop(&oldest)) {
+            evicted_++;
+          }
+          break;
+        }
+        case BACKPRESSURE_BLOCK: {
+          std::unique_lock<std::mutex> lock(mutex_);
+          producers_waiting_++;
+          std::atomic_thread_fence(std::memory_order_seq_cst);
+          mgpp::detail::Wait(&not_full_, &lock, [this]() {
+            return queue_.size() < queue_.capacity();
+          });
+          producers_waiting_--;
+          break;
+        }
+      }
+    }
+  }
+
+  bool Idle() const { return queued_ == delivered_ + evicted_; }
+
+  std::size_t depth() const { return queue_.size(); }
+  std::size_t high_water() const { return high_water_; }
+  std::uint64_t delivered() const { return delivered_; }
+  std::uint64_t dropped() const { return evicted_ + rejected_; }
+
+ private:
+  void Run() {
+    for (;;) {
+      EventConstPtr event;
+      if (queue_.TryPop(&event)) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (producers_waiting_ > 0) {
+          std::lock_guard<std::mutex> lock(mutex_);
+          not_full_.notify_all();
+        }
+        Deliver(event);
+        delivered_++;
+        continue;
+      }
+
+      std::unique_lock<std::mutex> lock(mutex_);
+      consumer_waiting_ = true;
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      mgpp::detail::Wait(&not_empty_, &lock,
+                         [this]() { return stop_ || queue_.size() > 0; });
+      consumer_waiting_ = false;
+      if (stop_ && queue_.size() == 0) {
+        return;
+      }
+    }
+  }
+
+  void Deliver(const EventConstPtr &event) {
+    detail::EpochGuard guard;
+    const RouteTable *routes = owner_->routes_.load(std::memory_order_acquire);
+
+    auto iter = routes->routes.find(event->id());
+    if (iter != routes->routes.end() && iter->second.signals[index_]) {
+      (*iter->second.signals[index_])(event);
+    }
+  }
+
+  void UpdateHighWater() {
+    const std::size_t depth = queue_.size();
+    std::size_t high_water = high_water_.load(std::memory_order_relaxed);
+    while (depth > high_water &&
+           !high_water_.compare_exchange_weak(high_water, depth)) {
+    }
+  }
+
+  AsyncDispatcher *const owner_;
+  const std::size_t index_;
+  MpmcQueue<EventConstPtr> queue_;
+
+  // Each side announces that it is about to sleep, then fences before its
+  // last look at the queue. The other side fences after changing the queue
+  // and notifies under the mutex if it sees the announcement, so neither
+  // sleeps through a change.
+  std::mutex mutex_;
+  std::condition_variable not_empty_;
+  std::condition_variable not_full_;
+  bool stop_;
+  std::atomic<bool> consumer_waiting_;
+  std::atomic<int> producers_waiting_;
+
+  std::atomic<std::size_t> high_water_;
+  std::atomic<std::uint64_t> queued_;
+  std::atomic<std::uint64_t> delivered_;
+  std::atomic<std::uint64_t> evicted_;   // dropped from the queue
+  std::atomic<std::uint64_t> rejected_;  // never queued
+
+  std::thread thread_;
+};
+
+AsyncDispatcher::AsyncDispatcher(const std::size_t workers,
+                                 const std::size_t capacity,
+                                 const Backpressure policy)
+    : policy_(policy),
+      published_(0),
+      next_worker_(0),
+      routes_(new RouteTable()) {
+  if (workers == 0 || workers > kMaxWorkers) {
+    throw std::invalid_argument("mgpp::signals: invalid number of workers");
+  }
+  for (std::size_t i = 0; i < workers; ++i) {
+    workers_.emplace_back(new Worker(this, i, capacity));
+  }
+}
+
+AsyncDispatcher::~AsyncDispatcher() {
+  // Workers deliver whatever is still queued before exiting
+  workers_.clear();
+  delete routes_.load();
+}
+
+void AsyncDispatcher::Replace(const RouteTable *routes) {
+  const RouteTable *old = routes_.exchange(routes);
+  detail::Epoch::Retire([old]() { delete old; });
+}
+
+Connection AsyncDispatcher::Subscribe(const int id, const EventCallback cb) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const RouteTable *routes = routes_.load(std::memory_order_relaxed);
+
+  // Pin subscribers to workers round-robin
+  const std::size_t worker = next_worker_++ % workers_.size();
+
+  auto iter = routes->routes.find(id);
+  if (iter != routes->routes.end() && iter->second.signals[worker]) {
+    return iter->second.signals[worker]->connect(cb);
+  }
+
+  RouteTable *table = new RouteTable(*routes);
+  AsyncRoute &route = table->routes[id];
+  if (route.signals.empty()) {
+    route.workers = 0;
+    route.signals.resize(workers_.size());
+  }
+  route.workers |= std::uint64_t(1) << worker;
+  route.signals[worker] = std::make_shared<EventSignal>();
+  Connection conn = route.signals[worker]->connect(cb);
+  Replace(table);
+  return conn;
+}
+
+void AsyncDispatcher::Unsubscribe(const int id, const Connection &conn) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const RouteTable *routes = routes_.load(std::memory_order_relaxed);
+
+  auto iter = routes->routes.find(id);
+  if (iter == routes->routes.end()) {
+    return;
+  }
+  conn.disconnect();
+
+  // Drop workers left without subscribers from the route
+  const AsyncRoute &route = iter->second;
+  bool changed = false;
+  for (std::size_t i = 0; i < route.signals.size(); ++i) {
+    if (route.signals[i] && route.signals[i]->empty()) {
+      changed = true;
+    }
+  }
+  if (changed) {
+    RouteTable *table = new RouteTable(*routes);
+    AsyncRoute &updated = table->routes[id];
+    for (std::size_t i = 0; i < updated.signals.size(); ++i) {
+      if (updated.signals[i] && updated.signals[i]->empty()) {
+        updated.signals[i].reset();
+        updated.workers &= ~(std::uint64_t(1) << i);
+      }
+    }
+    if (updated.workers == 0) {
+      table->routes.erase(id);
+    }
+    Replace(table);
+  }
+}
+
+void AsyncDispatcher::UnsubscribeAll(const int id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const RouteTable *routes = routes_.load(std::memory_order_relaxed);
+
+  RouteTable *table = new RouteTable(*routes);
+  for (auto iter = table->routes.begin(); iter != table->routes.end();) {
+    if (id == -1 || iter->first == id) {
+      for (auto &signal : iter->second.signals) {
+        if (signal) {
+          signal->disconnect_all_slots();
+        }
+      }
+      iter = table->routes.erase(iter);
+    } else {
+      ++iter;
+    }
+  }
+  Replace(table);
+}
+
+bool AsyncDispatcher::Publish(const EventConstPtr &event) {
+  std::uint64_t workers = 0;
+  {
+    detail::EpochGuard guard;
+    const RouteTable *routes = routes_.load(std::memory_order_acquire);
+    auto iter = routes->routes.find(event->id());
+    if (iter != routes->routes.end()) {
+      workers = iter->second.workers;
+    }
+  }
+
+  // Each worker queue accepts or rejects the event on its own, so a full
+  // queue under DROP_NEWEST does not take the event away from the others
+  std::size_t routed = 0;
+  std::size_t rejected = 0;
+  for (std::size_t i = 0; workers != 0; ++i, workers >>= 1) {
+    if (workers & 1) {
+      routed++;
+      if (!workers_[i]->Push(event, policy_)) {
+        rejected++;
+      }
+    }
+  }
+  if (routed == 0 || rejected < routed) {
+    published_++;
+  }
+  return rejected == 0;
+}
+
+int AsyncDispatcher::NumSlots(const int id) {
+  detail::EpochGuard guard;
+  const RouteTable *routes = routes_.load(std::memory_order_acquire);
+
+  int slots = 0;
+  auto iter = routes->routes.find(id);
+  if (iter != routes->routes.end()) {
+    for (auto &signal : iter->second.signals) {
+      if (signal) {
+        slots += signal->num_slots();
+      }
+    }
+  }
+  return slots;
+}
+
+void AsyncDispatcher::Drain() {
+  for (auto &worker : workers_) {
+    while (!worker->Idle()) {
+      std::this_thread::yield();
+    }
+  }
+}
+
+AsyncMetrics AsyncDispatcher::metrics() const {
+  AsyncMetrics metrics = AsyncMetrics();
+  metrics.published = published_;
+  for (auto &worker : workers_) {
+    metrics.depth += worker->depth();
+    metrics.high_water = std::max(metrics.high_water, worker->high_water());
+    metrics.delivered += worker->delivered();
+    metrics.dropped += worker->dropped();
+  }
+  return metrics;
+}
+
+}  // namespace signals
+}  // namespace mgpp
@@ -26,86 +26,266 @@
 
 #include <mgpp/signals/dispatcher.hpp>
 
+#include <atomic>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "mgpp/signals/dispatcher_metrics.hpp"
+#include "mgpp/signals/epoch.hpp"
+#include "mgpp/signals/topic_router.hpp"
+
 namespace mgpp {
 namespace signals {
 
-// singleton dispatcher class
-class Dispatcher {
+using EventSignalPtr = std::shared_ptr<EventSignal>;
+
+// Id to signal table. Event ids are usually small contiguous ints, so ids
+// below `dense_limit` index straight into an array that grows on demand.
+// Any other id falls back to a hash map.
+class Dispatcher::SignalTable {
  public:
-  Dispatcher(const Dispatcher &) = delete;
-  Dispatcher &operator=(const Dispatcher &) = delete;
-  Dispatcher(Dispatcher &&) = delete;
-  Dispatcher &operator=(Dispatcher &&) = delete;
-
-  Connection Subscribe(const int id, const EventCallback cb);
-  void Unsubscribe(const int id, const Connection &conn);
-  void UnsubscribeAll(const int id = -1);
-  void Publish(EventConstPtr event);
-  int NumSlots(const int id);
-
-  static Dispatcher &Instance() {
-    static Dispatcher dispatcher;
-    return dispatcher;
+  explicit SignalTable(const int dense_limit) : dense_limit_(dense_limit) {}
+
+  EventSignal *Find(const int id) const {
+    const std::size_t index = static_cast<std::size_t>(id);
+    if (index < dense_.size()) {
+      return dense_[index].get();
+    }
+    return FindSparse(id);
+  }
+
+  void Insert(const int id, EventSignalPtr signal) {
+    if (id >= 0 && id < dense_limit_) {
+      const std::size_t index = static_cast<std::size_t>(id);
+      if (index >= dense_.size()) {
+        dense_.resize(index + 1);
+      }
+      dense_[index] = std::move(signal);
+    } else {
+      sparse_[id] = std::move(signal);
+    }
+  }
+
+  void Erase(const int id) {
+    const std::size_t index = static_cast<std::size_t>(id);
+    if (index < dense_.size()) {
+      dense_[index].reset();
+      while (!dense_.empty() && !dense_.back()) {
+        dense_.pop_back();
+      }
+    } else {
+      sparse_.erase(id);
+    }
+  }
+
+  template <typename Fn>
+  void ForEach(Fn fn) const {
+    for (std::size_t i = 0; i < dense_.size(); ++i) {
+      if (dense_[i]) {
+        fn(static_cast<int>(i), dense_[i]);
+      }
+    }
+    for (auto &signal : sparse_) {
+      fn(signal.first, signal.second);
+    }
   }
 
+  int dense_limit() const { return dense_limit_; }
+
  private:
-  Dispatcher();
-  ~Dispatcher();
+  EventSignal *FindSparse(const int id) const {
+    if (sparse_.empty()) {
+      return nullptr;
+    }
+    auto iter = sparse_.find(id);
+    return iter != sparse_.end() ? iter->second.get() : nullptr;
+  }
 
-  std::unordered_map<int, EventSignal> signals_;
+  int dense_limit_;
+  std::vector<EventSignalPtr> dense_;
+  std::unordered_map<int, EventSignalPtr> sparse_;
 };
 
-Dispatcher::Dispatcher() = default;
-Dispatcher::~Dispatcher() = default;
+Dispatcher::Dispatcher(const int dense_limit)
+    : signals_(new SignalTable(dense_limit)),
+      topics_(new detail::TopicRouter(this)) {
+#ifdef MGPP_SIGNALS_METRICS
+  stats_.reset(new detail::DispatcherStats());
+#endif
+}
+
+Dispatcher::~Dispatcher() { delete signals_.load(); }
+
+Dispatcher &Dispatcher::Instance() {
+  static Dispatcher dispatcher;
+  return dispatcher;
+}
+
+void Dispatcher::Replace(const SignalTable *table) {
+  const SignalTable *old = signals_.exchange(table);
+  detail::Epoch::Retire([old]() { delete old; });
+}
 
 Connection Dispatcher::Subscribe(const int id, const EventCallback cb) {
+#ifdef MGPP_SIGNALS_METRICS
+  const EventCallback slot = stats_->TimedSlot(id, cb);
+#else
+  const EventCallback &slot = cb;
+#endif
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  return Connect(id, slot);
+}
+
+Connection Dispatcher::Subscribe(const int id, const EventFilter &filter,
+                                 const EventCallback cb) {
+#ifdef MGPP_SIGNALS_METRICS
+  const EventCallback slot = stats_->TimedSlot(id, cb);
+#else
+  const EventCallback &slot = cb;
+#endif
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  FilterGroup &group = filters_[FilterKey(id, filter.key())];
+  if (!group.slots) {
+    EventSignalPtr slots = std::make_shared<EventSignal>();
+    group.slots = slots;
+    group.connection =
+        Connect(id, [filter, slots](const EventConstPtr &event) {
+          if (filter(*event)) {
+            (*slots)(event);
+          }
+        });
+  }
+  return group.slots->connect(slot);
+}
+
+Connection Dispatcher::Connect(const int id, const EventCallback &slot) {
+  const SignalTable *signals = signals_.load(std::memory_order_relaxed);
+
+  EventSignal *signal = signals->Find(id);
+  if (signal != nullptr) {
+    return signal->connect(slot);
+  }
+
   // Creates a new signal if `id` is not already in `signals_`
-  return signals_[id].connect(cb);
+  EventSignalPtr new_signal = std::make_shared<EventSignal>();
+  Connection conn = new_signal->connect(slot);
+  SignalTable *table = new SignalTable(*signals);
+  table->Insert(id, new_signal);
+  Replace(table);
+  return conn;
 }
 
 void Dispatcher::Unsubscribe(const int id, const Connection &conn) {
-  if (signals_.count(id) > 0) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const SignalTable *signals = signals_.load(std::memory_order_relaxed);
+
+  EventSignal *signal = signals->Find(id);
+  if (signal != nullptr) {
     conn.disconnect();
+    RemoveFilters(id, false);
 
-    if (signals_[id].empty()) {
-      signals_.erase(id);
+    if (signal->empty()) {
+      SignalTable *table = new SignalTable(*signals);
+      table->Erase(id);
+      Replace(table);
     }
   }
 }
 
 void Dispatcher::UnsubscribeAll(const int id) {
+  // Before taking `mutex_`, since the router subscribes under its own lock
+  if (id == -1) {
+    topics_->Clear();
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  const SignalTable *signals = signals_.load(std::memory_order_relaxed);
+
   if (id == -1) {
-    for (auto &signal : signals_) {
-      signal.second.disconnect_all_slots();
+    for (auto &filter : filters_) {
+      filter.second.slots->disconnect_all_slots();
     }
-    signals_.clear();
+    filters_.clear();
+    signals->ForEach([](const int, const EventSignalPtr &signal) {
+      signal->disconnect_all_slots();
+    });
+    Replace(new SignalTable(signals->dense_limit()));
   } else {
-    if (signals_.count(id) > 0) {
-      signals_[id].disconnect_all_slots();
-      signals_.erase(id);
+    RemoveFilters(id, true);
+    EventSignal *signal = signals->Find(id);
+    if (signal != nullptr) {
+      signal->disconnect_all_slots();
+      SignalTable *table = new SignalTable(*signals);
+      table->Erase(id);
+      Replace(table);
     }
   }
 }
 
-void Dispatcher::Publish(EventConstPtr event) {
-  if (signals_.count(event->id()) > 0) {
-    signals_[event->id()](event);
+// Drop the filter groups of `id`, or only those left without slots
+void Dispatcher::RemoveFilters(const int id, const bool all) {
+  auto group = filters_.lower_bound(FilterKey(id, std::string()));
+  while (group != filters_.end() && group->first.first == id) {
+    if (all || group->second.slots->empty()) {
+      group->second.slots->disconnect_all_slots();
+      group->second.connection.disconnect();
+      group = filters_.erase(group);
+    } else {
+      ++group;
+    }
+  }
+}
+
+void Dispatcher::Publish(const EventConstPtr &event) {
+#ifdef MGPP_SIGNALS_METRICS
+  detail::PublishProbe probe(stats_.get(), event->id());
+#endif
+  detail::EpochGuard guard;
+  const SignalTable *signals = signals_.load(std::memory_order_acquire);
+
+  const EventSignal *signal = signals->Find(event->id());
+  if (signal != nullptr) {
+    (*signal)(event);
   }
 }
 
 int Dispatcher::NumSlots(const int id) {
-  if (signals_.count(id) > 0) {
-    return signals_[id].num_slots();
+  detail::EpochGuard guard;
+  const SignalTable *signals = signals_.load(std::memory_order_acquire);
+
+  const EventSignal *signal = signals->Find(id);
+  if (signal != nullptr) {
+    return signal->num_slots();
   } else {
     return 0;
   }
 }
 
+void Dispatcher::SetDenseIds(const int limit) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  const SignalTable *signals = signals_.load(std::memory_order_relaxed);
+
+  // Rebuild the table so existing ids move to the right side of the limit
+  SignalTable *table = new SignalTable(limit);
+  signals->ForEach([table](const int id, const EventSignalPtr &signal) {
+    table->Insert(id, signal);
+  });
+  Replace(table);
+}
+
 // Subscribe functions
 Connection Subscribe(const int id, const EventCallback cb) {
   return Dispatcher::Instance().Subscribe(id, cb);
 }
 
+Connection Subscribe(const int id, const EventFilter &filter,
+                     const EventCallback cb) {
+  return Dispatcher::Instance().Subscribe(id, filter, cb);
+}
+
 // Unsubscribe functions
 void Unsubscribe(const int id, const Connection &conn) {
   Dispatcher::Instance().Unsubscribe(id, conn);
@@ -115,9 +295,13 @@ void Unsubscribe(const int id, const Connection &conn) {
 void UnsubscribeAll(const int id) { Dispatcher::Instance().UnsubscribeAll(id); }
 
 // Publish function
-void Publish(EventConstPtr event) { Dispatcher::Instance().Publish(event); }
+void Publish(const EventConstPtr &event) {
+  Dispatcher::Instance().Publish(event);
+}
 
 int NumSlots(const int id) { return Dispatcher::Instance().NumSlots(id); }
 
+void SetDenseIds(const int limit) { Dispatcher::Instance().SetDenseIds(limit); }
+
 }  // namespace signals
 }  // namespace mgpp
@@ -0,0 +1,132 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_SIGNALS_DISPATCHER_METRICS_HPP_
+#define MGPP_SIGNALS_DISPATCHER_METRICS_HPP_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include <mgpp/noncopyable.hpp>
+#include <mgpp/signals/dispatcher.hpp>
+#include <mgpp/signals/metrics.hpp>
+
+namespace mgpp {
+namespace signals {
+namespace detail {
+
+struct IdStats {
+  explicit IdStats(const int id)
+      : id(id), publishes(0), slot_calls(0), max_fanout(0), slots(0) {}
+
+  const int id;
+  std::atomic<std::uint64_t> publishes;
+  std::atomic<std::uint64_t> slot_calls;
+  std::atomic<std::uint64_t> max_fanout;
+  std::atomic<std::size_t> slots;  // slots ever subscribed
+};
+
+struct SlotStats {
+  SlotStats(const int id, const std::size_t slot) : id(id), slot(slot) {}
+
+  const int id;
+  const std::size_t slot;
+  Histogram latency;
+};
+
+// Stats of one dispatcher: those of every id it has seen, kept as long as
+// the dispatcher, and of every slot still subscribed. A slot's stats are
+// owned by its callback and go when the dispatcher drops it.
+class DispatcherStats : private Noncopyable {
+ public:
+  DispatcherStats();
+
+  IdStats *ForId(const int id);
+
+  // Wrap a callback subscribed to `id` so that its calls are timed
+  EventCallback TimedSlot(const int id, EventCallback cb);
+
+  template <typename Fn>
+  void ForEachId(Fn fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &stats : ids_) {
+      fn(*stats.second);
+    }
+  }
+
+  template <typename Fn>
+  void ForEachSlot(Fn fn) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Prune();
+    for (auto &slot : slots_) {
+      std::shared_ptr<SlotStats> stats = slot.lock();
+      if (stats) {
+        fn(*stats);
+      }
+    }
+  }
+
+ private:
+  // Ids below this are found without locking
+  static const int kDenseIds = 1024;
+  static const std::size_t kMinPrune = 64;
+
+  // Drop the entries of unsubscribed slots. Must hold `mutex_`.
+  void Prune();
+
+  std::atomic<IdStats *> dense_[kDenseIds];
+  std::mutex mutex_;
+  std::unordered_map<int, std::unique_ptr<IdStats>> ids_;
+  std::vector<std::weak_ptr<SlotStats>> slots_;
+  std::size_t prune_at_;  // prune before adding a slot beyond this many
+};
+
+// Counts one publish and the slots it calls. Publishes from within a slot
+// nest, each counting only its own slots.
+class PublishProbe : private Noncopyable {
+ public:
+  PublishProbe(DispatcherStats *stats, const int id);
+  ~PublishProbe();
+
+  // Called by each timed slot of the innermost publish on this thread
+  static void SlotCalled();
+
+ private:
+  IdStats *stats_;
+  std::uint64_t slots_;
+  PublishProbe *outer_;
+};
+
+}  // namespace detail
+}  // namespace signals
+}  // namespace mgpp
+
+#endif  // MGPP_SIGNALS_DISPATCHER_METRICS_HPP_
@@ -0,0 +1,219 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include "mgpp/signals/epoch.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+namespace mgpp {
+namespace signals {
+namespace detail {
+
+namespace {
+
+constexpr std::size_t kBlockRecords = 64;
+constexpr std::uint64_t kActive = 1;
+
+// Per-thread reader state: (epoch << 1) | kActive while inside a guard.
+// Records are cache line sized so readers never share a line.
+struct alignas(64) ThreadRecord {
+  std::atomic<std::uint64_t> state;
+  std::atomic<bool> in_use;
+};
+
+// Reader records come in blocks chained off `first_block`. Blocks are only
+// ever appended, so the registry grows to the most reader threads alive at
+// once and records are reused as threads come and go.
+struct RecordBlock {
+  RecordBlock() : next(nullptr) {
+    for (ThreadRecord &record : records) {
+      record.state.store(0, std::memory_order_relaxed);
+      record.in_use.store(false, std::memory_order_relaxed);
+    }
+  }
+
+  ThreadRecord records[kBlockRecords];
+  std::atomic<RecordBlock *> next;
+};
+
+// Blocks are over-aligned, which plain new only honours from C++17 on
+RecordBlock *NewBlock() {
+  void *memory = nullptr;
+  if (posix_memalign(&memory, alignof(RecordBlock), sizeof(RecordBlock)) !=
+      0) {
+    throw std::bad_alloc();
+  }
+  return new (memory) RecordBlock();
+}
+
+struct Garbage {
+  std::uint64_t epoch;
+  std::function<void()> reclaim;
+};
+
+// Intentionally leaked so threads can still exit, and objects be retired,
+// during static destruction
+RecordBlock *first_block = NewBlock();
+std::atomic<std::uint64_t> global_epoch(0);
+
+std::mutex garbage_mutex;
+std::vector<Garbage> *garbage = new std::vector<Garbage>();
+
+// Claim a free record, appending a block when all of them are taken
+ThreadRecord *ClaimRecord() {
+  RecordBlock *block = first_block;
+  for (;;) {
+    for (ThreadRecord &record : block->records) {
+      bool expected = false;
+      if (!record.in_use.load(std::memory_order_relaxed) &&
+          record.in_use.compare_exchange_strong(expected, true)) {
+        return &record;
+      }
+    }
+
+    RecordBlock *next = block->next.load();
+    if (!next) {
+      RecordBlock *fresh = NewBlock();
+      if (block->next.compare_exchange_strong(next, fresh)) {
+        next = fresh;
+      } else {
+        std::free(fresh);
+      }
+    }
+    block = next;
+  }
+}
+
+// Advance the global epoch if every active reader has observed the current
+// one. Must be called with garbage_mutex held.
+void TryAdvance() {
+  std::uint64_t epoch = global_epoch.load();
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+
+  for (const RecordBlock *block = first_block; block;
+       block = block->next.load()) {
+    for (const ThreadRecord &record : block->records) {
+      const std::uint64_t state = record.state.load();
+      if ((state & kActive) && (state >> 1) != epoch) {
+        return;
+      }
+    }
+  }
+
+  global_epoch.compare_exchange_strong(epoch, epoch + 1);
+}
+
+// Retire `reclaim`, if any, then run everything no reader can still see
+void Collect(std::function<void()> reclaim) {
+  std::vector<std::function<void()>> ready;
+  {
+    std::lock_guard<std::mutex> lock(garbage_mutex);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (reclaim) {
+      garbage->push_back(Garbage{global_epoch.load(), std::move(reclaim)});
+    }
+    if (garbage->empty()) {
+      return;
+    }
+
+    TryAdvance();
+
+    // Anything retired two epochs ago can no longer be seen by a reader
+    const std::uint64_t epoch = global_epoch.load();
+    auto keep = garbage->begin();
+    for (auto iter = garbage->begin(); iter != garbage->end(); ++iter) {
+      if (iter->epoch + 2 <= epoch) {
+        ready.push_back(std::move(iter->reclaim));
+      } else {
+        *keep++ = std::move(*iter);
+      }
+    }
+    garbage->erase(keep, garbage->end());
+  }
+
+  // Reclaim outside the lock, destructors may retire objects of their own
+  for (auto &fn : ready) {
+    fn();
+  }
+}
+
+// Claims a record for the calling thread on first use. When the thread exits
+// the record is released and the garbage the thread may have been holding
+// back is reclaimed.
+class ThreadSlot : private Noncopyable {
+ public:
+  ThreadSlot() : record_(ClaimRecord()), depth_(0) {}
+
+  ~ThreadSlot() {
+    record_->state.store(0, std::memory_order_release);
+    record_->in_use.store(false, std::memory_order_release);
+    Epoch::Quiesce();
+  }
+
+  ThreadRecord *record_;
+  unsigned depth_;
+};
+
+ThreadSlot &CurrentSlot() {
+  static thread_local ThreadSlot slot;
+  return slot;
+}
+
+}  // namespace
+
+void Epoch::Enter() {
+  ThreadSlot &slot = CurrentSlot();
+  if (slot.depth_++ == 0) {
+    const std::uint64_t epoch =
+        global_epoch.load(std::memory_order_relaxed);
+    slot.record_->state.store((epoch << 1) | kActive,
+                              std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+  }
+}
+
+void Epoch::Exit() {
+  ThreadSlot &slot = CurrentSlot();
+  if (--slot.depth_ == 0) {
+    slot.record_->state.store(0, std::memory_order_release);
+  }
+}
+
+void Epoch::Retire(std::function<void()> reclaim) {
+  Collect(std::move(reclaim));
+}
+
+void Epoch::Quiesce() { Collect(nullptr); }
+
+}  // namespace detail
+}  // namespace signals
+}  // namespace mgpp
@@ -0,0 +1,65 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_SIGNALS_EPOCH_HPP_
+#define MGPP_SIGNALS_EPOCH_HPP_
+
+#include <functional>
+
+#include <mgpp/noncopyable.hpp>
+
+namespace mgpp {
+namespace signals {
+namespace detail {
+
+// Epoch based reclamation for read-mostly structures.
+//
+// Readers bracket their accesses with an EpochGuard, which never blocks and
+// may be nested. Writers unlink an object so no new reader can reach it, then
+// hand its destruction to Retire(). The object is destroyed once every reader
+// that could still hold a reference to it has left its guard, by a later call
+// to Retire() or Quiesce(). Reader threads quiesce when they exit.
+class Epoch {
+ public:
+  static void Enter();
+  static void Exit();
+  static void Retire(std::function<void()> reclaim);
+
+  // Reclaim whatever readers have moved past, without retiring anything
+  static void Quiesce();
+};
+
+class EpochGuard : private Noncopyable {
+ public:
+  EpochGuard() { Epoch::Enter(); }
+  ~EpochGuard() { Epoch::Exit(); }
+};
+
+}  // namespace detail
+}  // namespace signals
+}  // namespace mgpp
+
+#endif  // MGPP_SIGNALS_EPOCH_HPP_
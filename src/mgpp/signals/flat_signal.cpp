@@ -0,0 +1,217 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <mgpp/signals/flat_signal.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <mutex>
+#include <utility>
+
+#include "mgpp/signals/epoch.hpp"
+
+namespace mgpp {
+namespace signals {
+
+namespace {
+
+constexpr std::size_t kMinCapacity = 4;
+
+}  // namespace
+
+struct FlatSlotState {
+  FlatSlotState(std::weak_ptr<FlatSignal::Core> core, std::size_t generation)
+      : connected(true), core(std::move(core)), generation(generation) {}
+
+  bool Disconnect();
+
+  std::atomic<bool> connected;
+  std::weak_ptr<FlatSignal::Core> core;
+
+  // Value of Core::generation when connected. Once disconnect_all_slots
+  // bumps it the slot is no longer in the current list or counted as live.
+  const std::size_t generation;
+};
+
+struct FlatSlot {
+  FlatSignal::Slot slot;
+  std::shared_ptr<FlatSlotState> state;
+};
+
+// Fixed capacity slot array. Entries below `size` are immutable once
+// published, so readers only need to load `size` to iterate safely.
+struct FlatSlotList {
+  explicit FlatSlotList(std::size_t capacity)
+      : capacity(capacity), size(0), slots(new FlatSlot[capacity]) {}
+
+  const std::size_t capacity;
+  std::atomic<std::size_t> size;
+  std::unique_ptr<FlatSlot[]> slots;
+};
+
+struct FlatSignal::Core {
+  Core()
+      : slots(new FlatSlotList(kMinCapacity)),
+        live(0),
+        tombstones(0),
+        generation(0) {}
+  ~Core() {
+    FlatSlotList *list = slots.load();
+    const std::size_t size = list->size.load();
+    for (std::size_t i = 0; i < size; ++i) {
+      list->slots[i].state->connected = false;
+    }
+    delete list;
+  }
+
+  // Install `list` as the current slot array. Must hold `mutex`.
+  void Replace(FlatSlotList *list) {
+    const FlatSlotList *old = slots.exchange(list);
+    tombstones = 0;
+    detail::Epoch::Retire([old]() { delete old; });
+  }
+
+  // Copy the live slots into a new array with room for `capacity` slots
+  FlatSlotList *Compact(std::size_t capacity) const {
+    const FlatSlotList *current = slots.load(std::memory_order_relaxed);
+    FlatSlotList *list = new FlatSlotList(capacity);
+
+    std::size_t size = 0;
+    const std::size_t current_size = current->size.load();
+    for (std::size_t i = 0; i < current_size; ++i) {
+      if (current->slots[i].state->connected) {
+        list->slots[size++] = current->slots[i];
+      }
+    }
+    list->size.store(size, std::memory_order_relaxed);
+    return list;
+  }
+
+  std::mutex mutex;
+  std::atomic<FlatSlotList *> slots;
+  std::atomic<std::size_t> live;
+  std::size_t tombstones;
+  std::size_t generation;
+};
+
+bool FlatSlotState::Disconnect() {
+  if (!connected.exchange(false)) {
+    return false;
+  }
+
+  std::shared_ptr<FlatSignal::Core> signal = core.lock();
+  if (signal) {
+    std::lock_guard<std::mutex> lock(signal->mutex);
+
+    // disconnect_all_slots may have dropped the slot between clearing
+    // `connected` and taking the lock, in which case it is already
+    // uncounted
+    if (generation != signal->generation) {
+      return true;
+    }
+    signal->live--;
+
+    // Compact once the array is mostly tombstones
+    const std::size_t live = signal->live.load();
+    if (++signal->tombstones > live &&
+        signal->tombstones >= kMinCapacity) {
+      signal->Replace(signal->Compact(std::max(kMinCapacity, live * 2)));
+    }
+  }
+  return true;
+}
+
+FlatConnection::FlatConnection() = default;
+
+FlatConnection::FlatConnection(std::shared_ptr<FlatSlotState> state)
+    : state_(std::move(state)) {}
+
+void FlatConnection::disconnect() const {
+  if (state_) {
+    state_->Disconnect();
+  }
+}
+
+bool FlatConnection::connected() const { return state_ && state_->connected; }
+
+FlatSignal::FlatSignal() : core_(std::make_shared<Core>()) {}
+
+FlatSignal::~FlatSignal() = default;
+
+FlatConnection FlatSignal::connect(const Slot &slot) {
+  std::lock_guard<std::mutex> lock(core_->mutex);
+  FlatSlotList *list = core_->slots.load(std::memory_order_relaxed);
+
+  std::size_t size = list->size.load(std::memory_order_relaxed);
+  if (size == list->capacity) {
+    // Out of room, grow the array dropping any tombstones along the way
+    list = core_->Compact(std::max(kMinCapacity, (core_->live + 1) * 2));
+    core_->Replace(list);
+    size = list->size.load(std::memory_order_relaxed);
+  }
+
+  std::shared_ptr<FlatSlotState> state =
+      std::make_shared<FlatSlotState>(core_, core_->generation);
+  list->slots[size].slot = slot;
+  list->slots[size].state = state;
+  list->size.store(size + 1, std::memory_order_release);
+  core_->live++;
+
+  return FlatConnection(state);
+}
+
+void FlatSignal::disconnect_all_slots() {
+  std::lock_guard<std::mutex> lock(core_->mutex);
+  const FlatSlotList *list = core_->slots.load(std::memory_order_relaxed);
+
+  const std::size_t size = list->size.load(std::memory_order_relaxed);
+  for (std::size_t i = 0; i < size; ++i) {
+    list->slots[i].state->connected = false;
+  }
+  core_->live = 0;
+  core_->generation++;
+  core_->Replace(new FlatSlotList(kMinCapacity));
+}
+
+bool FlatSignal::empty() const { return core_->live == 0; }
+
+std::size_t FlatSignal::num_slots() const { return core_->live; }
+
+void FlatSignal::operator()(const EventConstPtr &event) const {
+  detail::EpochGuard guard;
+  const FlatSlotList *list = core_->slots.load(std::memory_order_acquire);
+
+  const std::size_t size = list->size.load(std::memory_order_acquire);
+  for (std::size_t i = 0; i < size; ++i) {
+    const FlatSlot &slot = list->slots[i];
+    if (slot.state->connected.load(std::memory_order_acquire)) {
+      slot.slot(event);
+    }
+  }
+}
+
+}  // namespace signals
+}  // namespace mgpp
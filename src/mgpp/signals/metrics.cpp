@@ -0,0 +1,249 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <mgpp/signals/metrics.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "mgpp/signals/dispatcher_metrics.hpp"
+
+namespace mgpp {
+namespace signals {
+
+const std::size_t Histogram::kBuckets;
+
+double Histogram::mean() const {
+  const std::uint64_t count = count_.load(std::memory_order_relaxed);
+  return count > 0 ? static_cast<double>(sum_.load(std::memory_order_relaxed)) /
+                         static_cast<double>(count)
+                   : 0.0;
+}
+
+std::uint64_t Histogram::Percentile(const double fraction) const {
+  const std::uint64_t count = count_.load(std::memory_order_relaxed);
+  if (count == 0) {
+    return 0;
+  }
+  const std::uint64_t rank =
+      std::max<std::uint64_t>(1, static_cast<std::uint64_t>(fraction * count));
+  std::uint64_t seen = 0;
+  for (std::size_t bucket = 0; bucket < kBuckets; ++bucket) {
+    seen += buckets_[bucket].load(std::memory_order_relaxed);
+    if (seen >= rank) {
+      return std::min(BucketMax(bucket), max());
+    }
+  }
+  return max();
+}
+
+void Histogram::Reset() {
+  for (std::atomic<std::uint64_t> &bucket : buckets_) {
+    bucket.store(0, std::memory_order_relaxed);
+  }
+  count_.store(0, std::memory_order_relaxed);
+  sum_.store(0, std::memory_order_relaxed);
+  max_.store(0, std::memory_order_relaxed);
+}
+
+std::uint64_t Histogram::BucketMax(const std::size_t bucket) {
+  if (bucket < 16) {
+    return bucket;
+  }
+  const unsigned magnitude = static_cast<unsigned>((bucket - 16) / 8 + 4);
+  const std::uint64_t mantissa = 8 + (bucket - 16) % 8 + 1;
+  return (mantissa << (magnitude - 3)) - 1;
+}
+
+namespace detail {
+
+const int DispatcherStats::kDenseIds;
+const std::size_t DispatcherStats::kMinPrune;
+
+DispatcherStats::DispatcherStats() : prune_at_(kMinPrune) {
+  for (std::atomic<IdStats *> &stats : dense_) {
+    stats.store(nullptr, std::memory_order_relaxed);
+  }
+}
+
+IdStats *DispatcherStats::ForId(const int id) {
+  if (id >= 0 && id < kDenseIds) {
+    IdStats *stats = dense_[id].load(std::memory_order_acquire);
+    if (stats) {
+      return stats;
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::unique_ptr<IdStats> &stats = ids_[id];
+  if (!stats) {
+    stats.reset(new IdStats(id));
+    if (id >= 0 && id < kDenseIds) {
+      dense_[id].store(stats.get(), std::memory_order_release);
+    }
+  }
+  return stats.get();
+}
+
+EventCallback DispatcherStats::TimedSlot(const int id, EventCallback cb) {
+  IdStats *id_stats = ForId(id);
+  std::shared_ptr<SlotStats> stats = std::make_shared<SlotStats>(
+      id, id_stats->slots.fetch_add(1, std::memory_order_relaxed));
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (slots_.size() >= prune_at_) {
+      Prune();
+      prune_at_ = std::max(kMinPrune, slots_.size() * 2);
+    }
+    slots_.push_back(stats);
+  }
+
+  return [stats, cb](const EventConstPtr &event) {
+    PublishProbe::SlotCalled();
+    const std::chrono::steady_clock::time_point start =
+        std::chrono::steady_clock::now();
+    cb(event);
+    stats->latency.Record(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - start)
+            .count()));
+  };
+}
+
+void DispatcherStats::Prune() {
+  slots_.erase(std::remove_if(slots_.begin(), slots_.end(),
+                              [](const std::weak_ptr<SlotStats> &slot) {
+                                return slot.expired();
+                              }),
+               slots_.end());
+}
+
+namespace {
+
+thread_local PublishProbe *current_probe = nullptr;
+
+}  // namespace
+
+PublishProbe::PublishProbe(DispatcherStats *stats, const int id)
+    : stats_(stats->ForId(id)), slots_(0), outer_(current_probe) {
+  current_probe = this;
+}
+
+PublishProbe::~PublishProbe() {
+  current_probe = outer_;
+  stats_->publishes.fetch_add(1, std::memory_order_relaxed);
+  stats_->slot_calls.fetch_add(slots_, std::memory_order_relaxed);
+  std::uint64_t max = stats_->max_fanout.load(std::memory_order_relaxed);
+  while (slots_ > max && !stats_->max_fanout.compare_exchange_weak(
+                             max, slots_, std::memory_order_relaxed)) {
+  }
+}
+
+void PublishProbe::SlotCalled() {
+  if (current_probe) {
+    ++current_probe->slots_;
+  }
+}
+
+}  // namespace detail
+
+std::vector<IdMetrics> Dispatcher::id_metrics() const {
+  std::vector<IdMetrics> metrics;
+  if (!stats_) {
+    return metrics;
+  }
+  stats_->ForEachId([&metrics](const detail::IdStats &stats) {
+    metrics.push_back({stats.id, stats.publishes.load(),
+                       stats.slot_calls.load(), stats.max_fanout.load()});
+  });
+  std::sort(metrics.begin(), metrics.end(),
+            [](const IdMetrics &a, const IdMetrics &b) { return a.id < b.id; });
+  return metrics;
+}
+
+std::vector<SlotMetrics> Dispatcher::slot_metrics() const {
+  std::vector<SlotMetrics> metrics;
+  if (!stats_) {
+    return metrics;
+  }
+  stats_->ForEachSlot([&metrics](const detail::SlotStats &stats) {
+    metrics.push_back({stats.id, stats.slot, stats.latency.count(),
+                       stats.latency.mean(), stats.latency.Percentile(0.5),
+                       stats.latency.Percentile(0.99), stats.latency.max()});
+  });
+  std::sort(metrics.begin(), metrics.end(),
+            [](const SlotMetrics &a, const SlotMetrics &b) {
+              return a.p99_ns != b.p99_ns ? a.p99_ns > b.p99_ns
+                                          : a.mean_ns > b.mean_ns;
+            });
+  return metrics;
+}
+
+void Dispatcher::DumpMetrics(std::ostream &out) const {
+  for (const IdMetrics &id : id_metrics()) {
+    out << "id " << id.id << ": " << id.publishes << " publishes, "
+        << id.slot_calls << " slot calls, max fan-out " << id.max_fanout
+        << "\n";
+  }
+  for (const SlotMetrics &slot : slot_metrics()) {
+    out << "id " << slot.id << " slot " << slot.slot << ": " << slot.calls
+        << " calls, mean " << slot.mean_ns << " ns, p50 " << slot.p50_ns
+        << " ns, p99 " << slot.p99_ns << " ns, max " << slot.max_ns
+        << " ns\n";
+  }
+}
+
+void Dispatcher::ResetMetrics() {
+  if (!stats_) {
+    return;
+  }
+  stats_->ForEachId([](detail::IdStats &stats) {
+    stats.publishes.store(0, std::memory_order_relaxed);
+    stats.slot_calls.store(0, std::memory_order_relaxed);
+    stats.max_fanout.store(0, std::memory_order_relaxed);
+  });
+  stats_->ForEachSlot([](detail::SlotStats &stats) { stats.latency.Reset(); });
+}
+
+std::vector<IdMetrics> DispatcherIdMetrics() {
+  return Dispatcher::Instance().id_metrics();
+}
+
+std::vector<SlotMetrics> DispatcherSlotMetrics() {
+  return Dispatcher::Instance().slot_metrics();
+}
+
+void DumpDispatcherMetrics(std::ostream &out) {
+  Dispatcher::Instance().DumpMetrics(out);
+}
+
+void ResetDispatcherMetrics() { Dispatcher::Instance().ResetMetrics(); }
+
+}  // namespace signals
+}  // namespace mgpp
@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <mgpp/signals/topic.hpp>
+
+#include <algorithm>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "mgpp/signals/topic_router.hpp"
+
+namespace mgpp {
+namespace signals {
+
+namespace {
+
+using detail::Levels;
+
+Levels Split(const std::string &topic) {
+  Levels levels;
+  std::size_t begin = 0;
+  for (;;) {
+    const std::size_t end = topic.find('/', begin);
+    levels.push_back(topic.substr(begin, end - begin));
+    if (end == std::string::npos) {
+      return levels;
+    }
+    begin = end + 1;
+  }
+}
+
+Levels ParseTopic(const std::string &topic) {
+  const Levels levels = Split(topic);
+  for (const std::string &level : levels) {
+    if (level.empty() || level.find_first_of("+#") != std::string::npos) {
+      throw std::invalid_argument("mgpp::signals: invalid topic " + topic);
+    }
+  }
+  return levels;
+}
+
+Levels ParsePattern(const std::string &pattern) {
+  const Levels levels = Split(pattern);
+  for (std::size_t i = 0; i < levels.size(); ++i) {
+    const std::string &level = levels[i];
+    const bool wildcard =
+        level == "+" || (level == "#" && i + 1 == levels.size());
+    if (level.empty() ||
+        (!wildcard && level.find_first_of("+#") != std::string::npos)) {
+      throw std::invalid_argument("mgpp::signals: invalid topic pattern " +
+                                  pattern);
+    }
+  }
+  return levels;
+}
+
+bool Matches(const Levels &pattern, const Levels &topic) {
+  std::size_t i = 0;
+  for (; i < pattern.size(); ++i) {
+    if (pattern[i] == "#") {
+      return true;
+    }
+    if (i == topic.size() || (pattern[i] != "+" && pattern[i] != topic[i])) {
+      return false;
+    }
+  }
+  return i == topic.size();
+}
+
+}  // namespace
+
+namespace detail {
+
+void TopicRouter::Register(const int id, const std::string &topic) {
+  const Levels levels = ParseTopic(topic);
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto named = names_.find(id);
+  if (named != names_.end()) {
+    if (named->second == topic) {
+      return;
+    }
+    throw std::invalid_argument("mgpp::signals: id already has a topic");
+  }
+  if (!ids_.insert(std::make_pair(topic, id)).second) {
+    throw std::invalid_argument("mgpp::signals: topic already registered " +
+                                topic);
+  }
+  names_[id] = topic;
+  topics_.Insert(levels, id);
+
+  for (auto &subscription : subscriptions_) {
+    Pattern &pattern = subscription.second;
+    if (Matches(pattern.levels, levels)) {
+      pattern.connections.emplace_back(id,
+                                       dispatcher_->Subscribe(id, pattern.cb));
+    }
+  }
+}
+
+TopicSubscription TopicRouter::Add(const std::string &pattern,
+                                   const EventCallback cb) {
+  Pattern subscription;
+  subscription.levels = ParsePattern(pattern);
+  subscription.cb = cb;
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  std::vector<int> ids;
+  topics_.Match(subscription.levels, &ids);
+  for (const int id : ids) {
+    subscription.connections.emplace_back(id, dispatcher_->Subscribe(id, cb));
+  }
+
+  const std::size_t key = next_key_++;
+  subscriptions_.insert(std::make_pair(key, std::move(subscription)));
+  return TopicSubscription(key);
+}
+
+void TopicRouter::Remove(const TopicSubscription &subscription) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto pattern = subscriptions_.find(subscription.key_);
+  if (pattern == subscriptions_.end()) {
+    return;
+  }
+  for (const auto &connection : pattern->second.connections) {
+    dispatcher_->Unsubscribe(connection.first, connection.second);
+  }
+  subscriptions_.erase(pattern);
+}
+
+void TopicRouter::Clear() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  subscriptions_.clear();
+}
+
+std::vector<int> TopicRouter::Match(const std::string &pattern) {
+  const Levels levels = ParsePattern(pattern);
+  std::vector<int> ids;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    topics_.Match(levels, &ids);
+  }
+  std::sort(ids.begin(), ids.end());
+  return ids;
+}
+
+}  // namespace detail
+
+void Dispatcher::RegisterTopic(const int id, const std::string &topic) {
+  topics_->Register(id, topic);
+}
+
+TopicSubscription Dispatcher::SubscribeTopic(const std::string &pattern,
+                                             const EventCallback cb) {
+  return topics_->Add(pattern, cb);
+}
+
+void Dispatcher::UnsubscribeTopic(const TopicSubscription &subscription) {
+  topics_->Remove(subscription);
+}
+
+std::vector<int> Dispatcher::MatchTopic(const std::string &pattern) {
+  return topics_->Match(pattern);
+}
+
+void RegisterTopic(const int id, const std::string &topic) {
+  Dispatcher::Instance().RegisterTopic(id, topic);
+}
+
+TopicSubscription SubscribeTopic(const std::string &pattern,
+                                 const EventCallback cb) {
+  return Dispatcher::Instance().SubscribeTopic(pattern, cb);
+}
+
+void UnsubscribeTopic(const TopicSubscription &subscription) {
+  Dispatcher::Instance().UnsubscribeTopic(subscription);
+}
+
+std::vector<int> MatchTopic(const std::string &pattern) {
+  return Dispatcher::Instance().MatchTopic(pattern);
+}
+
+}  // namespace signals
+}  // namespace mgpp
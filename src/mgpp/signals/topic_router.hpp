@@ -0,0 +1,138 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+
+#ifndef MGPP_SIGNALS_TOPIC_ROUTER_HPP_
+#define MGPP_SIGNALS_TOPIC_ROUTER_HPP_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <mgpp/noncopyable.hpp>
+#include <mgpp/signals/dispatcher.hpp>
+
+namespace mgpp {
+namespace signals {
+namespace detail {
+
+using Levels = std::vector<std::string>;
+
+// Registered topics, one level per node
+class TopicTrie {
+ public:
+  void Insert(const Levels &topic, const int id) {
+    Node *node = &root_;
+    for (const std::string &level : topic) {
+      std::unique_ptr<Node> &child = node->children[level];
+      if (!child) {
+        child.reset(new Node());
+      }
+      node = child.get();
+    }
+    node->ids.push_back(id);
+  }
+
+  void Match(const Levels &pattern, std::vector<int> *ids) const {
+    Match(root_, pattern, 0, ids);
+  }
+
+ private:
+  struct Node {
+    std::unordered_map<std::string, std::unique_ptr<Node>> children;
+    std::vector<int> ids;  // of the topic ending here, at most one
+  };
+
+  static void Match(const Node &node, const Levels &pattern,
+                    const std::size_t level, std::vector<int> *ids) {
+    if (level == pattern.size()) {
+      ids->insert(ids->end(), node.ids.begin(), node.ids.end());
+    } else if (pattern[level] == "#") {
+      Collect(node, ids);
+    } else if (pattern[level] == "+") {
+      for (const auto &child : node.children) {
+        Match(*child.second, pattern, level + 1, ids);
+      }
+    } else {
+      auto child = node.children.find(pattern[level]);
+      if (child != node.children.end()) {
+        Match(*child->second, pattern, level + 1, ids);
+      }
+    }
+  }
+
+  static void Collect(const Node &node, std::vector<int> *ids) {
+    ids->insert(ids->end(), node.ids.begin(), node.ids.end());
+    for (const auto &child : node.children) {
+      Collect(*child.second, ids);
+    }
+  }
+
+  Node root_;
+};
+
+// Topics registered with one dispatcher, the patterns subscribed to it and
+// the connections they resolved to
+class TopicRouter : private Noncopyable {
+ public:
+  explicit TopicRouter(Dispatcher *dispatcher)
+      : dispatcher_(dispatcher), next_key_(1) {}
+
+  void Register(const int id, const std::string &topic);
+  TopicSubscription Add(const std::string &pattern, const EventCallback cb);
+  void Remove(const TopicSubscription &subscription);
+
+  // Forget every pattern subscription, without touching the slots they were
+  // resolved to. Called by UnsubscribeAll, which disconnects those anyway.
+  void Clear();
+
+  std::vector<int> Match(const std::string &pattern);
+
+ private:
+  struct Pattern {
+    Levels levels;
+    EventCallback cb;
+    std::vector<std::pair<int, Connection>> connections;
+  };
+
+  Dispatcher *const dispatcher_;
+  std::mutex mutex_;
+  TopicTrie topics_;
+  std::unordered_map<int, std::string> names_;
+  std::unordered_map<std::string, int> ids_;
+  std::unordered_map<std::size_t, Pattern> subscriptions_;
+  std::size_t next_key_;
+};
+
+}  // namespace detail
+}  // namespace signals
+}  // namespace mgpp
+
+#endif  // MGPP_SIGNALS_TOPIC_ROUTER_HPP_
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef MGPP_WAIT_HPP_
+#define MGPP_WAIT_HPP_
+
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+
+namespace mgpp {
+namespace detail {
+
+// Block on `cv` until `ready` returns true. Whoever makes it true must
+// notify with the mutex held, or after a seq_cst fence that pairs with one
+// taken by the waiter, so no wakeup is lost and no timeout is needed.
+//
+// Goes through wait_until all the same: the untimed wait is an exported
+// libstdc++ symbol that GCC 12 headers bind to a newer version than older
+// runtimes provide, while timed waits are inline.
+template <typename Predicate>
+void Wait(std::condition_variable *cv, std::unique_lock<std::mutex> *lock,
+          Predicate ready) {
+  cv->wait_until(*lock, std::chrono::steady_clock::time_point::max(), ready);
+}
+
+}  // namespace detail
+}  // namespace mgpp
+
+#endif  // MGPP_WAIT_HPP_
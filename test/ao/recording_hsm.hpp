@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#ifndef TEST_AO_RECORDING_HSM_HPP_
+#define TEST_AO_RECORDING_HSM_HPP_
+
+#include <atomic>
+#include <functional>
+#include <utility>
+#include <vector>
+
+#include <mgpp/ao.hpp>
+
+// Records the events it handles and checks that handlers never overlap.
+// Tests add behaviour of their own through the optional hook, which runs
+// after each event is recorded.
+class RecordingHsm : public mgpp::ao::Hsm {
+ public:
+  using Hook = std::function<void(const mgpp::ao::EventConstPtr &)>;
+
+  explicit RecordingHsm(Hook hook = Hook())
+      : mgpp::ao::Hsm(mgpp::ao::StateCast(Initial)),
+        busy_(false),
+        overlapped_(false),
+        count_(0),
+        hook_(std::move(hook)) {}
+
+  static mgpp::ao::StateAction Initial(RecordingHsm *const me,
+                                       const mgpp::ao::EventConstPtr &evt) {
+    (void)evt;
+    return me->InitialTransition(Running);
+  }
+
+  static mgpp::ao::StateAction Running(RecordingHsm *const me,
+                                       const mgpp::ao::EventConstPtr &evt) {
+    switch (evt->id()) {
+      case mgpp::ao::ENTRY_SIG:
+      case mgpp::ao::INIT_SIG:
+      case mgpp::ao::EXIT_SIG:
+        return me->Handled();
+      case mgpp::ao::SUPER_SIG:
+        return me->Super(mgpp::ao::Hsm::Top);
+    }
+
+    if (me->busy_.exchange(true)) {
+      me->overlapped_ = true;
+    }
+    me->signals_.push_back(evt->id());
+    me->events_.push_back(evt.get());
+    if (me->hook_) {
+      me->hook_(evt);
+    }
+    me->count_++;
+    me->busy_ = false;
+    return me->Handled();
+  }
+
+  std::atomic<bool> busy_;
+  std::atomic<bool> overlapped_;
+  std::atomic<int> count_;
+  std::vector<int> signals_;
+  std::vector<const mgpp::ao::Event *> events_;
+  Hook hook_;
+};
+
+#endif  // TEST_AO_RECORDING_HSM_HPP_
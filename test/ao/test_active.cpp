@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <mgpp/ao.hpp>
+
+#include "recording_hsm.hpp"
+
+enum ActiveTestEvent { COUNT_SIG = mgpp::ao::USER_SIG, FIRST_SIG, LIFO_SIG };
+
+class ActiveTest : public ::testing::Test {
+ protected:
+  ActiveTest()
+      : hsm_(new RecordingHsm()),
+        active_(std::unique_ptr<mgpp::ao::Hsm>(hsm_), 1024) {
+    hsm_->hook_ = [this](const mgpp::ao::EventConstPtr &evt) {
+      if (evt->id() == FIRST_SIG) {
+        active_.PostLifo(
+            mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(LIFO_SIG)));
+      }
+    };
+  }
+
+  RecordingHsm *hsm_;
+  mgpp::ao::Active active_;
+};
+
+TEST_F(ActiveTest, PostFromManyThreads) {
+  const int kPosters = 4;
+  const int kPosts = 5000;
+
+  active_.Start();
+  std::vector<std::thread> posters;
+  for (int i = 0; i < kPosters; ++i) {
+    posters.emplace_back([this]() {
+      mgpp::ao::EventConstPtr evt(
+          mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(COUNT_SIG)));
+      for (int j = 0; j < kPosts; ++j) {
+        while (!active_.Post(evt)) {
+          std::this_thread::yield();
+        }
+      }
+    });
+  }
+  for (auto &poster : posters) {
+    poster.join();
+  }
+  active_.Stop();
+
+  EXPECT_EQ(static_cast<std::size_t>(kPosters * kPosts),
+            hsm_->signals_.size());
+  EXPECT_FALSE(hsm_->overlapped_);
+}
+
+TEST_F(ActiveTest, PostLifoRunsAheadOfQueue) {
+  // Queue both events before starting so they are dispatched back to back
+  active_.Post(
+      mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(FIRST_SIG)));
+  active_.Post(
+      mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(COUNT_SIG)));
+  active_.Start();
+  active_.Stop();
+
+  EXPECT_EQ(std::vector<int>({FIRST_SIG, LIFO_SIG, COUNT_SIG}),
+            hsm_->signals_);
+}
+
+TEST(Active, PostFailsWhenFull) {
+  mgpp::ao::Active active(std::unique_ptr<mgpp::ao::Hsm>(new RecordingHsm()),
+                          4);
+  mgpp::ao::EventConstPtr evt(
+      mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(COUNT_SIG)));
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_TRUE(active.Post(evt));
+  }
+  EXPECT_FALSE(active.Post(evt));
+}
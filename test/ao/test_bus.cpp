@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <mgpp/ao.hpp>
+#include <mgpp/signals.hpp>
+
+#include "recording_hsm.hpp"
+
+enum BusTestSignal { X_SIG = mgpp::ao::USER_SIG + 100, Y_SIG };
+
+class BusTest : public ::testing::Test {
+ protected:
+  explicit BusTest(const std::size_t count = 3) : scheduler_(2) {
+    for (std::size_t i = 0; i < count; ++i) {
+      hsms_.push_back(new RecordingHsm());
+      actives_.emplace_back(new mgpp::ao::Active(
+          std::unique_ptr<mgpp::ao::Hsm>(hsms_.back()), 16, &scheduler_));
+      actives_.back()->Start();
+    }
+  }
+
+  // Stop the active objects so their records can be read
+  void StopAll() {
+    for (auto &active : actives_) {
+      active->Stop();
+    }
+  }
+
+  mgpp::ao::Scheduler scheduler_;
+  std::vector<RecordingHsm *> hsms_;
+  std::vector<std::unique_ptr<mgpp::ao::Active>> actives_;
+  mgpp::ao::Bus bus_;
+};
+
+TEST_F(BusTest, PublishReachesSubscribers) {
+  bus_.Subscribe(actives_[0].get(), X_SIG);
+  bus_.Subscribe(actives_[1].get(), X_SIG);
+  bus_.Subscribe(actives_[1].get(), Y_SIG);
+  bus_.Subscribe(actives_[2].get(), Y_SIG);
+  EXPECT_EQ(2u, bus_.NumSubscribers(X_SIG));
+
+  // One dispatcher slot per id, however many active objects subscribe
+  EXPECT_EQ(1, mgpp::signals::NumSlots(X_SIG));
+  EXPECT_EQ(1, mgpp::signals::NumSlots(Y_SIG));
+
+  mgpp::ao::EventConstPtr x(mgpp::ao::MakeEvent<mgpp::ao::Event>(X_SIG));
+  mgpp::ao::EventConstPtr y(mgpp::ao::MakeEvent<mgpp::ao::Event>(Y_SIG));
+  mgpp::signals::Publish(x);
+  mgpp::signals::Publish(y);
+  StopAll();
+
+  // Every subscriber is handed the published event itself
+  typedef std::vector<const mgpp::ao::Event *> Events;
+  EXPECT_EQ(Events({x.get()}), hsms_[0]->events_);
+  EXPECT_EQ(Events({x.get(), y.get()}), hsms_[1]->events_);
+  EXPECT_EQ(Events({y.get()}), hsms_[2]->events_);
+}
+
+TEST_F(BusTest, Unsubscribe) {
+  bus_.Subscribe(actives_[0].get(), X_SIG);
+  bus_.Subscribe(actives_[1].get(), X_SIG);
+  bus_.Unsubscribe(actives_[0].get(), X_SIG);
+  EXPECT_EQ(1u, bus_.NumSubscribers(X_SIG));
+
+  bus_.UnsubscribeAll(actives_[1].get());
+  EXPECT_EQ(0u, bus_.NumSubscribers(X_SIG));
+  EXPECT_EQ(0, mgpp::signals::NumSlots(X_SIG));
+
+  mgpp::signals::Publish(mgpp::ao::MakeEvent<mgpp::ao::Event>(X_SIG));
+  StopAll();
+  EXPECT_TRUE(hsms_[0]->events_.empty());
+  EXPECT_TRUE(hsms_[1]->events_.empty());
+}
+
+TEST_F(BusTest, OwnDispatcher) {
+  mgpp::signals::Dispatcher dispatcher;
+  mgpp::ao::Bus bus(dispatcher);
+  bus.Subscribe(actives_[0].get(), X_SIG);
+  EXPECT_EQ(1, dispatcher.NumSlots(X_SIG));
+  EXPECT_EQ(0, mgpp::signals::NumSlots(X_SIG));
+
+  mgpp::ao::EventConstPtr x(mgpp::ao::MakeEvent<mgpp::ao::Event>(X_SIG));
+  mgpp::signals::Publish(mgpp::ao::MakeEvent<mgpp::ao::Event>(X_SIG));
+  dispatcher.Publish(x);
+  StopAll();
+  EXPECT_EQ(std::vector<const mgpp::ao::Event *>({x.get()}),
+            hsms_[0]->events_);
+}
+
+TEST(Bus, CountsDroppedEvents) {
+  // Never started, so its queue of 2 fills up
+  mgpp::ao::Active active(
+      std::unique_ptr<mgpp::ao::Hsm>(new RecordingHsm()), 2);
+  mgpp::ao::Bus bus;
+  bus.Subscribe(&active, X_SIG);
+  for (int i = 0; i < 10; ++i) {
+    mgpp::signals::Publish(mgpp::ao::MakeEvent<mgpp::ao::Event>(X_SIG));
+  }
+  EXPECT_EQ(8u, bus.dropped());
+  bus.UnsubscribeAll(&active);
+}
+
+// An active object given the bit of one that just unsubscribed must not get
+// the events published to its predecessor
+TEST_F(BusTest, ReusedBitsGetNoStaleEvents) {
+  std::atomic<bool> done(false);
+  std::thread publisher([&done]() {
+    mgpp::ao::EventConstPtr x(mgpp::ao::MakeEvent<mgpp::ao::Event>(X_SIG));
+    while (!done) {
+      mgpp::signals::Publish(x);
+    }
+  });
+
+  for (int i = 0; i < 2000; ++i) {
+    bus_.Subscribe(actives_[0].get(), X_SIG);
+    bus_.UnsubscribeAll(actives_[0].get());
+    bus_.Subscribe(actives_[1].get(), Y_SIG);
+    bus_.UnsubscribeAll(actives_[1].get());
+  }
+  done = true;
+  publisher.join();
+  StopAll();
+
+  EXPECT_TRUE(hsms_[1]->events_.empty());
+  EXPECT_EQ(0, mgpp::signals::NumSlots(X_SIG));
+}
+
+class ManySubscribersTest : public BusTest {
+ protected:
+  ManySubscribersTest() : BusTest(mgpp::ao::Bus::kMaxSubscribers + 1) {}
+};
+
+TEST_F(ManySubscribersTest, FillsEveryBit) {
+  for (std::size_t i = 0; i < mgpp::ao::Bus::kMaxSubscribers; ++i) {
+    bus_.Subscribe(actives_[i].get(), X_SIG);
+  }
+  EXPECT_THROW(bus_.Subscribe(actives_.back().get(), X_SIG),
+               std::length_error);
+
+  mgpp::signals::Publish(mgpp::ao::MakeEvent<mgpp::ao::Event>(X_SIG));
+  StopAll();
+  for (std::size_t i = 0; i < mgpp::ao::Bus::kMaxSubscribers; ++i) {
+    EXPECT_EQ(1u, hsms_[i]->events_.size());
+  }
+  EXPECT_TRUE(hsms_.back()->events_.empty());
+}
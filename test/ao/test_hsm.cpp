@@ -28,9 +28,13 @@
 
 #include <iostream>
 #include <tuple>
+#include <type_traits>
+#include <vector>
 
 #include <mgpp/ao.hpp>
 
+#include "allocation_counter.hpp"
+
 using StateRecord = std::tuple<mgpp::ao::StateHandler, int>;
 
 template <class T>
@@ -54,7 +58,7 @@ class TestHsm : public mgpp::ao::Hsm {
   TestHsm() : mgpp::ao::Hsm(mgpp::ao::StateCast(TestTop)) {}
 
   static mgpp::ao::StateAction TestTop(TestHsm *const me,
-                                       mgpp::ao::EventConstPtr evt) {
+                                       const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "TestTop: Enter" << std::endl;
@@ -74,7 +78,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S1(TestHsm *const me,
-                                  mgpp::ao::EventConstPtr evt) {
+                                  const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S1: Enter" << std::endl;
@@ -94,7 +98,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S2(TestHsm *const me,
-                                  mgpp::ao::EventConstPtr evt) {
+                                  const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S2: Entry" << std::endl;
@@ -114,7 +118,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S3(TestHsm *const me,
-                                  mgpp::ao::EventConstPtr evt) {
+                                  const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S3: Entry" << std::endl;
@@ -162,7 +166,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S4(TestHsm *const me,
-                                  mgpp::ao::EventConstPtr evt) {
+                                  const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S4: Entry" << std::endl;
@@ -182,7 +186,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S5(TestHsm *const me,
-                                  mgpp::ao::EventConstPtr evt) {
+                                  const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S5: Entry" << std::endl;
@@ -202,7 +206,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S6(TestHsm *const me,
-                                  mgpp::ao::EventConstPtr evt) {
+                                  const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S6: Entry" << std::endl;
@@ -226,7 +230,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S7(TestHsm *const me,
-                                  mgpp::ao::EventConstPtr evt) {
+                                  const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S7: Entry" << std::endl;
@@ -246,7 +250,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S8(TestHsm *const me,
-                                  mgpp::ao::EventConstPtr evt) {
+                                  const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S8: Entry" << std::endl;
@@ -266,7 +270,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S9(TestHsm *const me,
-                                  mgpp::ao::EventConstPtr evt) {
+                                  const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S9: Entry" << std::endl;
@@ -286,7 +290,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S10(TestHsm *const me,
-                                   mgpp::ao::EventConstPtr evt) {
+                                   const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S10: Entry" << std::endl;
@@ -306,7 +310,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S11(TestHsm *const me,
-                                   mgpp::ao::EventConstPtr evt) {
+                                   const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S11: Entry" << std::endl;
@@ -326,7 +330,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S12(TestHsm *const me,
-                                   mgpp::ao::EventConstPtr evt) {
+                                   const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S12: Entry" << std::endl;
@@ -346,7 +350,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S13(TestHsm *const me,
-                                   mgpp::ao::EventConstPtr evt) {
+                                   const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S13: Entry" << std::endl;
@@ -366,7 +370,7 @@ class TestHsm : public mgpp::ao::Hsm {
   }
 
   static mgpp::ao::StateAction S14(TestHsm *const me,
-                                   mgpp::ao::EventConstPtr evt) {
+                                   const mgpp::ao::EventConstPtr &evt) {
     switch (evt->id()) {
       case mgpp::ao::ENTRY_SIG:
         std::cout << "S14: Entry" << std::endl;
@@ -630,3 +634,388 @@ TEST_F(HsmTest, IgnoreUnhandledEvent) {
   CompareStateRecord(records);
   EXPECT_EQ(hsm.state(), mgpp::ao::StateCast(TestHsm::S10));
 }
+
+TEST(Hsm, ConstructionAllocatesNoEvents) {
+  const std::vector<mgpp::signals::PoolMetrics> before(
+      mgpp::signals::EventPoolMetrics());
+  {
+    TestHsm hsm;
+    hsm.Init();
+  }
+  const std::vector<mgpp::signals::PoolMetrics> after(
+      mgpp::signals::EventPoolMetrics());
+  for (std::size_t i = 0; i < before.size(); ++i) {
+    EXPECT_EQ(before[i].in_use, after[i].in_use);
+  }
+}
+
+// Two sibling leaves under a common parent, counting super state probes
+class ProbeHsm : public mgpp::ao::Hsm {
+ public:
+  ProbeHsm() : mgpp::ao::Hsm(mgpp::ao::StateCast(Initial)) {}
+
+  static mgpp::ao::StateAction Initial(ProbeHsm *const me,
+                                       const mgpp::ao::EventConstPtr &evt) {
+    (void)evt;
+    return me->InitialTransition(Left);
+  }
+
+  static mgpp::ao::StateAction Parent(ProbeHsm *const me,
+                                      const mgpp::ao::EventConstPtr &evt) {
+    return me->Probe(evt, mgpp::ao::StateCast(mgpp::ao::Hsm::Top));
+  }
+
+  static mgpp::ao::StateAction Left(ProbeHsm *const me,
+                                    const mgpp::ao::EventConstPtr &evt) {
+    if (evt->id() == A_SIG) {
+      return me->Transition(Right);
+    }
+    return me->Probe(evt, mgpp::ao::StateCast(Parent));
+  }
+
+  static mgpp::ao::StateAction Right(ProbeHsm *const me,
+                                     const mgpp::ao::EventConstPtr &evt) {
+    if (evt->id() == A_SIG) {
+      return me->Transition(Left);
+    }
+    return me->Probe(evt, mgpp::ao::StateCast(Parent));
+  }
+
+  int probes_ = 0;
+  int entries_ = 0;
+  int exits_ = 0;
+
+ private:
+  mgpp::ao::StateAction Probe(const mgpp::ao::EventConstPtr &evt,
+                              mgpp::ao::StateHandler super) {
+    switch (evt->id()) {
+      case mgpp::ao::SUPER_SIG:
+        ++probes_;
+        break;
+      case mgpp::ao::ENTRY_SIG:
+        ++entries_;
+        return Handled();
+      case mgpp::ao::EXIT_SIG:
+        ++exits_;
+        return Handled();
+    }
+    return Super<mgpp::ao::StateHandler>(super);
+  }
+};
+
+TEST(Hsm, RepeatedTransitionsReplayCachedPath) {
+  ProbeHsm hsm;
+  hsm.Init();
+  mgpp::ao::EventConstPtr toggle(mgpp::ao::MakeEvent<mgpp::ao::Event>(A_SIG));
+
+  hsm.Dispatch(toggle);
+  hsm.Dispatch(toggle);
+  EXPECT_EQ(hsm.state(), mgpp::ao::StateCast(ProbeHsm::Left));
+
+  const int probes = hsm.probes_;
+  hsm.entries_ = 0;
+  hsm.exits_ = 0;
+  for (int i = 0; i < 100; ++i) {
+    hsm.Dispatch(toggle);
+  }
+
+  // Each transition exits and enters one leaf, the parent is left alone
+  EXPECT_EQ(hsm.probes_, probes);
+  EXPECT_EQ(hsm.exits_, 100);
+  EXPECT_EQ(hsm.entries_, 100);
+  EXPECT_EQ(hsm.state(), mgpp::ao::StateCast(ProbeHsm::Left));
+}
+
+TEST(Hsm, InstancesStaySmall) {
+  // Transition paths are cached outside the instances
+  EXPECT_LE(sizeof(ProbeHsm),
+            128 + mgpp::ao::Hsm::kDeferCapacity *
+                      sizeof(mgpp::ao::EventConstPtr));
+}
+
+TEST(Hsm, TransitionsDoNotAllocate) {
+  ProbeHsm hsm;
+  const int before_init = Allocations();
+  hsm.Init();
+  EXPECT_EQ(Allocations(), before_init);
+
+  mgpp::ao::EventConstPtr toggle(mgpp::ao::MakeEvent<mgpp::ao::Event>(A_SIG));
+  const int before = Allocations();
+  for (int i = 0; i < 10; ++i) {
+    hsm.Dispatch(toggle);
+  }
+  EXPECT_EQ(Allocations(), before);
+}
+
+// Sibling leaves that can each transition to any other, so dispatching it
+// through every pair takes kLeaves * (kLeaves - 1) distinct transitions
+class MeshHsm : public mgpp::ao::Hsm {
+ public:
+  static const int kLeaves = 32;
+
+  MeshHsm() : mgpp::ao::Hsm(mgpp::ao::StateCast(Initial)) {}
+
+  static mgpp::ao::StateAction Initial(MeshHsm *const me,
+                                       const mgpp::ao::EventConstPtr &evt) {
+    (void)evt;
+    return me->InitialTransition(Leaf<0>);
+  }
+
+  template <int I>
+  static mgpp::ao::StateAction Leaf(MeshHsm *const me,
+                                    const mgpp::ao::EventConstPtr &evt) {
+    const int target = evt->id() - mgpp::ao::USER_SIG;
+    if (target >= 0 && target < kLeaves) {
+      return me->Transition<mgpp::ao::StateHandler>(
+          LeafAt(target, Index<0>()));
+    }
+    switch (evt->id()) {
+      case mgpp::ao::ENTRY_SIG:
+      case mgpp::ao::EXIT_SIG:
+      case mgpp::ao::INIT_SIG:
+        return me->Handled();
+    }
+    return me->Super(mgpp::ao::Hsm::Top);
+  }
+
+  // Take every transition between two leaves once
+  void Churn() {
+    for (int from = 0; from < kLeaves; ++from) {
+      for (int to = 0; to < kLeaves; ++to) {
+        if (to != from) {
+          Dispatch(mgpp::ao::MakeEvent<mgpp::ao::Event>(
+              static_cast<int>(mgpp::ao::USER_SIG) + to));
+          Dispatch(mgpp::ao::MakeEvent<mgpp::ao::Event>(
+              static_cast<int>(mgpp::ao::USER_SIG) + from));
+        }
+      }
+    }
+  }
+
+ private:
+  template <int I>
+  using Index = std::integral_constant<int, I>;
+
+  static mgpp::ao::StateHandler LeafAt(int leaf, Index<kLeaves>) {
+    (void)leaf;
+    return nullptr;
+  }
+
+  template <int I>
+  static mgpp::ao::StateHandler LeafAt(int leaf, Index<I>) {
+    return leaf == I ? mgpp::ao::StateCast(Leaf<I>)
+                     : LeafAt(leaf, Index<I + 1>());
+  }
+};
+
+// Moves from X11 to Y11, churning a MeshHsm from Y1's entry action as a
+// slot published to from there would
+class NestingHsm : public mgpp::ao::Hsm {
+ public:
+  NestingHsm() : mgpp::ao::Hsm(mgpp::ao::StateCast(Initial)) {}
+
+  static mgpp::ao::StateAction Initial(NestingHsm *const me,
+                                       const mgpp::ao::EventConstPtr &evt) {
+    (void)evt;
+    return me->InitialTransition(X11);
+  }
+
+  static mgpp::ao::StateAction X1(NestingHsm *const me,
+                                  const mgpp::ao::EventConstPtr &evt) {
+    return me->Record(X1, evt, mgpp::ao::StateCast(mgpp::ao::Hsm::Top));
+  }
+
+  static mgpp::ao::StateAction X11(NestingHsm *const me,
+                                   const mgpp::ao::EventConstPtr &evt) {
+    if (evt->id() == A_SIG) {
+      return me->Transition(Y11);
+    }
+    return me->Record(X11, evt, mgpp::ao::StateCast(X1));
+  }
+
+  static mgpp::ao::StateAction Y1(NestingHsm *const me,
+                                  const mgpp::ao::EventConstPtr &evt) {
+    if (evt->id() == mgpp::ao::ENTRY_SIG) {
+      me->inner_.Churn();
+    }
+    return me->Record(Y1, evt, mgpp::ao::StateCast(mgpp::ao::Hsm::Top));
+  }
+
+  static mgpp::ao::StateAction Y11(NestingHsm *const me,
+                                   const mgpp::ao::EventConstPtr &evt) {
+    return me->Record(Y11, evt, mgpp::ao::StateCast(Y1));
+  }
+
+  MeshHsm inner_;
+  std::vector<StateRecord> records_;
+
+ private:
+  template <class T>
+  mgpp::ao::StateAction Record(T state, const mgpp::ao::EventConstPtr &evt,
+                               mgpp::ao::StateHandler super) {
+    switch (evt->id()) {
+      case mgpp::ao::ENTRY_SIG:
+      case mgpp::ao::EXIT_SIG:
+        records_.push_back(CreateRecord(state, evt->id()));
+        return Handled();
+      case mgpp::ao::INIT_SIG:
+        return Handled();
+    }
+    return Super<mgpp::ao::StateHandler>(super);
+  }
+};
+
+TEST(Hsm, NestedDispatchDuringTransition) {
+  NestingHsm hsm;
+  hsm.inner_.Init();
+  hsm.Init();
+  hsm.records_.clear();
+
+  hsm.Dispatch(mgpp::ao::MakeEvent<mgpp::ao::Event>(A_SIG));
+
+  EXPECT_EQ(std::vector<StateRecord>(
+                {CreateRecord(NestingHsm::X11, mgpp::ao::EXIT_SIG),
+                 CreateRecord(NestingHsm::X1, mgpp::ao::EXIT_SIG),
+                 CreateRecord(NestingHsm::Y1, mgpp::ao::ENTRY_SIG),
+                 CreateRecord(NestingHsm::Y11, mgpp::ao::ENTRY_SIG)}),
+            hsm.records_);
+  EXPECT_EQ(hsm.state(), mgpp::ao::StateCast(NestingHsm::Y11));
+}
+
+TEST(Hsm, DispatchTableMatchesHierarchyWalk) {
+  TestHsm walk;
+  TestHsm table;
+  table.EnableDispatchTable();
+  walk.Init();
+  table.Init();
+
+  // Visit every state twice so the second pass runs from the table
+  const int signals[] = {E_SIG, A_SIG, E_SIG, B_SIG, H_SIG, D_SIG, C_SIG,
+                         F_SIG, G_SIG, A_SIG, H_SIG, E_SIG, A_SIG, E_SIG,
+                         B_SIG, H_SIG, D_SIG, C_SIG, F_SIG, G_SIG};
+  for (int sig : signals) {
+    mgpp::ao::EventConstPtr evt(mgpp::ao::MakeEvent<mgpp::ao::Event>(sig));
+    walk.Dispatch(evt);
+    table.Dispatch(evt);
+    EXPECT_EQ(walk.state(), table.state());
+  }
+  EXPECT_EQ(walk.records_, table.records_);
+}
+
+TEST(Hsm, DispatchTableSkipsPassingStates) {
+  ProbeHsm hsm;
+  hsm.EnableDispatchTable();
+  hsm.Init();
+  mgpp::ao::EventConstPtr unhandled(
+      mgpp::ao::MakeEvent<mgpp::ao::Event>(B_SIG));
+
+  hsm.Dispatch(unhandled);
+  const int probes = hsm.probes_;
+  for (int i = 0; i < 100; ++i) {
+    hsm.Dispatch(unhandled);
+  }
+
+  // Left and Parent pass B up, later dispatches go straight to Top
+  EXPECT_EQ(hsm.probes_, probes);
+}
+
+TEST(Hsm, DispatchBatchMatchesDispatch) {
+  TestHsm single;
+  TestHsm batch;
+  single.Init();
+  batch.Init();
+
+  // E and H transition, B is ignored in S6 and A is handled by S3
+  std::vector<mgpp::ao::EventConstPtr> events;
+  const int signals[] = {E_SIG, B_SIG, H_SIG, E_SIG, A_SIG};
+  for (int sig : signals) {
+    events.push_back(mgpp::ao::MakeEvent<mgpp::ao::Event>(sig));
+  }
+
+  for (const auto &evt : events) {
+    single.Dispatch(evt);
+  }
+  EXPECT_EQ(4u, batch.DispatchBatch(events.data(), events.size()));
+  EXPECT_EQ(single.records_, batch.records_);
+  EXPECT_EQ(single.state(), batch.state());
+
+  EXPECT_EQ(2u, batch.DispatchBatch(events.begin() + 3, events.end()));
+  EXPECT_EQ(0u, batch.DispatchBatch(events.data(), 0));
+}
+
+// Defers requests while busy and recalls one each time it becomes idle
+class DeferHsm : public mgpp::ao::Hsm {
+ public:
+  DeferHsm() : mgpp::ao::Hsm(mgpp::ao::StateCast(Busy)) {}
+
+  static mgpp::ao::StateAction Busy(DeferHsm *const me,
+                                    const mgpp::ao::EventConstPtr &evt) {
+    switch (evt->id()) {
+      case A_SIG:
+        me->full_ = !me->Defer(evt);
+        return me->Handled();
+      case B_SIG:
+        return me->Transition(Idle);
+    }
+    return me->Super(mgpp::ao::Hsm::Top);
+  }
+
+  static mgpp::ao::StateAction Idle(DeferHsm *const me,
+                                    const mgpp::ao::EventConstPtr &evt) {
+    switch (evt->id()) {
+      case mgpp::ao::ENTRY_SIG:
+        me->Recall();
+        return me->Handled();
+      case A_SIG:
+        me->served_.push_back(evt.get());
+        return me->Transition(Busy);
+    }
+    return me->Super(mgpp::ao::Hsm::Top);
+  }
+
+  bool full_ = false;
+  std::vector<const mgpp::ao::Event *> served_;
+};
+
+TEST(Hsm, DeferAndRecall) {
+  DeferHsm hsm;
+  hsm.Init();
+  mgpp::ao::EventConstPtr first(mgpp::ao::MakeEvent<mgpp::ao::Event>(A_SIG));
+  mgpp::ao::EventConstPtr second(mgpp::ao::MakeEvent<mgpp::ao::Event>(A_SIG));
+  mgpp::ao::EventConstPtr done(mgpp::ao::MakeEvent<mgpp::ao::Event>(B_SIG));
+
+  hsm.Dispatch(first);
+  hsm.Dispatch(second);
+  EXPECT_EQ(2u, hsm.deferred());
+
+  // The recalled request runs before Dispatch returns and puts the machine
+  // straight back into Busy
+  hsm.Dispatch(done);
+  EXPECT_EQ(hsm.state(), mgpp::ao::StateCast(DeferHsm::Busy));
+  EXPECT_EQ(1u, hsm.deferred());
+  ASSERT_EQ(1u, hsm.served_.size());
+  EXPECT_EQ(first.get(), hsm.served_[0]);
+
+  hsm.Dispatch(done);
+  EXPECT_EQ(0u, hsm.deferred());
+  ASSERT_EQ(2u, hsm.served_.size());
+  EXPECT_EQ(second.get(), hsm.served_[1]);
+
+  // Nothing left to recall, so the machine stays idle
+  hsm.Dispatch(done);
+  EXPECT_EQ(hsm.state(), mgpp::ao::StateCast(DeferHsm::Idle));
+}
+
+TEST(Hsm, DeferIsBounded) {
+  DeferHsm hsm;
+  hsm.Init();
+  mgpp::ao::EventConstPtr request(mgpp::ao::MakeEvent<mgpp::ao::Event>(A_SIG));
+
+  for (std::size_t i = 0; i < mgpp::ao::Hsm::kDeferCapacity; ++i) {
+    hsm.Dispatch(request);
+    EXPECT_FALSE(hsm.full_);
+  }
+  hsm.Dispatch(request);
+  EXPECT_TRUE(hsm.full_);
+  EXPECT_EQ(mgpp::ao::Hsm::kDeferCapacity, hsm.deferred());
+}
@@ -0,0 +1,170 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <mgpp/ao.hpp>
+
+#include "recording_hsm.hpp"
+
+enum KernelTestEvent { WORK_SIG = mgpp::ao::USER_SIG, NEXT_SIG };
+
+// (priority, signal) of every event handled, in dispatch order
+using DispatchLog = std::vector<std::pair<unsigned, int>>;
+
+class KernelTest : public ::testing::Test {
+ protected:
+  KernelTest() : kernel_([this]() { kernel_.Stop(); }) {}
+
+  ~KernelTest() { actives_.clear(); }
+
+  mgpp::ao::Active *Add(unsigned priority) {
+    RecordingHsm *hsm =
+        new RecordingHsm([this, priority](const mgpp::ao::EventConstPtr &evt) {
+          log_.push_back(std::make_pair(priority, evt->id()));
+        });
+    actives_.emplace_back(new mgpp::ao::Active(
+        std::unique_ptr<mgpp::ao::Hsm>(hsm), 16, &kernel_, priority));
+    return actives_.back().get();
+  }
+
+  void Post(mgpp::ao::Active *active, int sig) {
+    active->Post(mgpp::ao::MakeEvent<mgpp::ao::Event>(sig));
+  }
+
+  // Stops the kernel as soon as nothing is ready
+  mgpp::ao::Kernel kernel_;
+  std::vector<std::unique_ptr<mgpp::ao::Active>> actives_;
+  DispatchLog log_;
+};
+
+TEST(Kernel, InvalidPriority) {
+  mgpp::ao::Kernel kernel;
+  EXPECT_THROW(mgpp::ao::Active(std::unique_ptr<mgpp::ao::Hsm>(
+                                    new RecordingHsm()),
+                                4, &kernel, 0),
+               std::invalid_argument);
+  EXPECT_THROW(mgpp::ao::Active(std::unique_ptr<mgpp::ao::Hsm>(
+                                    new RecordingHsm()),
+                                4, &kernel, mgpp::ao::Kernel::kMaxPriority + 1),
+               std::invalid_argument);
+}
+
+TEST_F(KernelTest, DuplicatePriority) {
+  Add(3)->Start();
+  EXPECT_THROW(Add(3)->Start(), std::invalid_argument);
+}
+
+TEST_F(KernelTest, HighestPriorityFirst) {
+  mgpp::ao::Active *low = Add(1);
+  mgpp::ao::Active *mid = Add(20);
+  mgpp::ao::Active *high = Add(64);
+  for (auto &active : actives_) {
+    active->Start();
+  }
+
+  Post(low, WORK_SIG);
+  Post(mid, WORK_SIG);
+  Post(high, WORK_SIG);
+  Post(low, NEXT_SIG);
+  Post(high, NEXT_SIG);
+  kernel_.Run();
+
+  EXPECT_EQ(DispatchLog({{64, WORK_SIG},
+                         {64, NEXT_SIG},
+                         {20, WORK_SIG},
+                         {1, WORK_SIG},
+                         {1, NEXT_SIG}}),
+            log_);
+}
+
+TEST_F(KernelTest, PostBeforeStart) {
+  mgpp::ao::Active *active = Add(5);
+  Post(active, WORK_SIG);
+  kernel_.Run();
+  EXPECT_TRUE(log_.empty());
+
+  active->Start();
+  kernel_.Run();
+  EXPECT_EQ(DispatchLog({{5, WORK_SIG}}), log_);
+}
+
+TEST_F(KernelTest, StopFromKernelThread) {
+  mgpp::ao::Active *low = Add(1);
+  mgpp::ao::Active *stopper = nullptr;
+  RecordingHsm *hsm =
+      new RecordingHsm([&low, &stopper](const mgpp::ao::EventConstPtr &) {
+        low->Stop();
+        stopper->Stop();
+      });
+  actives_.emplace_back(new mgpp::ao::Active(
+      std::unique_ptr<mgpp::ao::Hsm>(hsm), 16, &kernel_, 2));
+  stopper = actives_.back().get();
+  low->Start();
+  stopper->Start();
+
+  // The first event detaches both at once rather than waiting for the
+  // kernel to drain them, which it could never do from inside its own step
+  Post(low, WORK_SIG);
+  Post(stopper, WORK_SIG);
+  Post(stopper, NEXT_SIG);
+  kernel_.Run();
+  EXPECT_EQ(std::vector<int>({WORK_SIG}), hsm->signals_);
+  EXPECT_TRUE(log_.empty());
+}
+
+TEST(Kernel, PostFromOtherThread) {
+  const int kPosts = 1000;
+
+  RecordingHsm *hsm = new RecordingHsm();
+  mgpp::ao::Kernel kernel;
+  mgpp::ao::Active active(std::unique_ptr<mgpp::ao::Hsm>(hsm), 16, &kernel, 1);
+  active.Start();
+
+  std::thread poster([&active]() {
+    mgpp::ao::EventConstPtr evt(
+        mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(WORK_SIG)));
+    for (int i = 0; i < kPosts; ++i) {
+      while (!active.Post(evt)) {
+        std::this_thread::yield();
+      }
+    }
+  });
+  std::thread kernel_thread(&mgpp::ao::Kernel::Run, &kernel);
+
+  poster.join();
+  active.Stop();
+  kernel.Stop();
+  kernel_thread.join();
+
+  EXPECT_EQ(static_cast<std::size_t>(kPosts), hsm->signals_.size());
+}
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include <mgpp/ao.hpp>
+
+#include "recording_hsm.hpp"
+
+enum SchedulerTestEvent { COUNT_SIG = mgpp::ao::USER_SIG, FIRST_SIG, LIFO_SIG };
+
+class SchedulerTest : public ::testing::Test {
+ protected:
+  static const int kActives = 200;
+
+  SchedulerTest() : scheduler_(4) {
+    for (int i = 0; i < kActives; ++i) {
+      RecordingHsm *hsm = new RecordingHsm();
+      actives_.emplace_back(new mgpp::ao::Active(
+          std::unique_ptr<mgpp::ao::Hsm>(hsm), 64, &scheduler_));
+      mgpp::ao::Active *active = actives_.back().get();
+      hsm->hook_ = [active](const mgpp::ao::EventConstPtr &evt) {
+        if (evt->id() == FIRST_SIG) {
+          active->PostLifo(mgpp::ao::MakeEvent<mgpp::ao::Event>(
+              static_cast<int>(LIFO_SIG)));
+        }
+      };
+      hsms_.push_back(hsm);
+    }
+  }
+
+  ~SchedulerTest() {
+    // Active objects must be stopped before their scheduler goes away
+    actives_.clear();
+  }
+
+  mgpp::ao::Scheduler scheduler_;
+  std::vector<std::unique_ptr<mgpp::ao::Active>> actives_;
+  std::vector<RecordingHsm *> hsms_;
+};
+
+TEST(Scheduler, NoWorkers) {
+  EXPECT_THROW(mgpp::ao::Scheduler(0), std::invalid_argument);
+}
+
+TEST_F(SchedulerTest, PostFromManyThreads) {
+  const int kPosters = 4;
+  const int kPosts = 100;
+
+  for (auto &active : actives_) {
+    active->Start();
+  }
+
+  mgpp::ao::EventConstPtr evt(
+      mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(COUNT_SIG)));
+  std::vector<std::thread> posters;
+  for (int i = 0; i < kPosters; ++i) {
+    posters.emplace_back([this, evt]() {
+      for (int j = 0; j < kPosts; ++j) {
+        for (auto &active : actives_) {
+          while (!active->Post(evt)) {
+            std::this_thread::yield();
+          }
+        }
+      }
+    });
+  }
+  for (auto &poster : posters) {
+    poster.join();
+  }
+  for (auto &active : actives_) {
+    active->Stop();
+  }
+
+  for (auto hsm : hsms_) {
+    EXPECT_EQ(kPosters * kPosts, hsm->count_);
+    EXPECT_FALSE(hsm->overlapped_);
+  }
+}
+
+TEST_F(SchedulerTest, PostBeforeStart) {
+  actives_[0]->Post(
+      mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(COUNT_SIG)));
+
+  // Nothing is dispatched until the initial transition has run, even once
+  // the scheduler has worked through events posted after it
+  actives_[1]->Start();
+  actives_[1]->Post(
+      mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(COUNT_SIG)));
+  actives_[1]->Stop();
+  EXPECT_EQ(1, hsms_[1]->count_);
+  EXPECT_EQ(0, hsms_[0]->count_);
+
+  actives_[0]->Start();
+  actives_[0]->Stop();
+  EXPECT_EQ(1, hsms_[0]->count_);
+}
+
+TEST_F(SchedulerTest, PostLifoRunsAheadOfQueue) {
+  actives_[0]->Post(
+      mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(FIRST_SIG)));
+  actives_[0]->Post(
+      mgpp::ao::MakeEvent<mgpp::ao::Event>(static_cast<int>(COUNT_SIG)));
+  actives_[0]->Start();
+  actives_[0]->Stop();
+
+  EXPECT_EQ(std::vector<int>({FIRST_SIG, LIFO_SIG, COUNT_SIG}),
+            hsms_[0]->signals_);
+}
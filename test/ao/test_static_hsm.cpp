@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <utility>
+#include <vector>
+
+#include <mgpp/ao.hpp>
+
+// Same state tree as the TestHsm in test_hsm.cpp, declared as types
+enum StateId {
+  TOP,
+  S1,
+  S2,
+  S3,
+  S4,
+  S5,
+  S6,
+  S7,
+  S8,
+  S9,
+  S10,
+  S11,
+  S12,
+  S13,
+  S14
+};
+
+enum TestEvent {
+  A_SIG = mgpp::ao::USER_SIG,
+  B_SIG,
+  C_SIG,
+  D_SIG,
+  E_SIG,
+  F_SIG,
+  G_SIG,
+  H_SIG
+};
+
+typedef std::pair<int, int> StateRecord;
+
+class TestStaticHsm;
+
+// State recording its entry, exit and initial transition
+template <class Self, int Id, class Parent>
+struct RecordedState : mgpp::ao::StaticState<Self, Parent> {
+  template <class Machine>
+  static void Entry(Machine &me) {
+    me.records_.push_back(StateRecord(Id, mgpp::ao::ENTRY_SIG));
+  }
+
+  template <class Machine>
+  static void Exit(Machine &me) {
+    me.records_.push_back(StateRecord(Id, mgpp::ao::EXIT_SIG));
+  }
+
+  template <class Machine>
+  static mgpp::ao::StateAction Init(Machine &me) {
+    me.records_.push_back(StateRecord(Id, mgpp::ao::INIT_SIG));
+    return mgpp::ao::ACTION_HANDLED;
+  }
+};
+
+struct TestTop;
+struct S1State;
+struct S2State;
+struct S3State;
+struct S4State;
+struct S5State;
+struct S6State;
+struct S7State;
+struct S8State;
+struct S9State;
+struct S10State;
+struct S11State;
+struct S12State;
+struct S13State;
+struct S14State;
+
+struct TestTop : RecordedState<TestTop, TOP, mgpp::ao::TopState> {
+  static mgpp::ao::StateAction Init(TestStaticHsm &me);
+};
+struct S1State : RecordedState<S1State, S1, TestTop> {};
+struct S2State : RecordedState<S2State, S2, S1State> {};
+struct S3State : RecordedState<S3State, S3, S2State> {
+  static mgpp::ao::StateAction Handle(TestStaticHsm &me,
+                                      const mgpp::ao::EventConstPtr &evt);
+};
+struct S4State : RecordedState<S4State, S4, S3State> {};
+struct S5State : RecordedState<S5State, S5, S4State> {};
+struct S6State : RecordedState<S6State, S6, S5State> {
+  static mgpp::ao::StateAction Handle(TestStaticHsm &me,
+                                      const mgpp::ao::EventConstPtr &evt);
+};
+struct S7State : RecordedState<S7State, S7, S2State> {};
+struct S8State : RecordedState<S8State, S8, S7State> {};
+struct S9State : RecordedState<S9State, S9, S8State> {};
+struct S10State : RecordedState<S10State, S10, S9State> {};
+struct S11State : RecordedState<S11State, S11, TestTop> {};
+struct S12State : RecordedState<S12State, S12, S11State> {};
+struct S13State : RecordedState<S13State, S13, S12State> {
+  static mgpp::ao::StateAction Init(TestStaticHsm &me);
+};
+struct S14State : RecordedState<S14State, S14, S13State> {};
+
+class TestStaticHsm : public mgpp::ao::StaticHsm<TestStaticHsm, TestTop> {
+ public:
+  std::vector<StateRecord> records_;
+};
+
+mgpp::ao::StateAction TestTop::Init(TestStaticHsm &me) {
+  me.records_.push_back(StateRecord(TOP, mgpp::ao::INIT_SIG));
+  return InitialTransitionTo<S3State>(me);
+}
+
+mgpp::ao::StateAction S3State::Handle(TestStaticHsm &me,
+                                      const mgpp::ao::EventConstPtr &evt) {
+  switch (evt->id()) {
+    case A_SIG:
+      me.records_.push_back(StateRecord(S3, evt->id()));
+      return TransitionTo<S3State>(me);
+    case B_SIG:
+      me.records_.push_back(StateRecord(S3, evt->id()));
+      return TransitionTo<S4State>(me);
+    case C_SIG:
+      me.records_.push_back(StateRecord(S3, evt->id()));
+      return TransitionTo<S7State>(me);
+    case D_SIG:
+      me.records_.push_back(StateRecord(S3, evt->id()));
+      return TransitionTo<S2State>(me);
+    case E_SIG:
+      me.records_.push_back(StateRecord(S3, evt->id()));
+      return TransitionTo<S6State>(me);
+    case F_SIG:
+      me.records_.push_back(StateRecord(S3, evt->id()));
+      return TransitionTo<S10State>(me);
+    case G_SIG:
+      me.records_.push_back(StateRecord(S3, evt->id()));
+      return TransitionTo<S13State>(me);
+  }
+  return mgpp::ao::ACTION_SUPER;
+}
+
+mgpp::ao::StateAction S6State::Handle(TestStaticHsm &me,
+                                      const mgpp::ao::EventConstPtr &evt) {
+  if (evt->id() == H_SIG) {
+    me.records_.push_back(StateRecord(S6, evt->id()));
+    return TransitionTo<S1State>(me);
+  }
+  return mgpp::ao::ACTION_SUPER;
+}
+
+mgpp::ao::StateAction S13State::Init(TestStaticHsm &me) {
+  me.records_.push_back(StateRecord(S13, mgpp::ao::INIT_SIG));
+  return InitialTransitionTo<S14State>(me);
+}
+
+class StaticHsmTest : public ::testing::Test {
+ protected:
+  virtual void SetUp() { hsm.Init(); }
+
+  void Dispatch(int sig) {
+    hsm.records_.clear();
+    hsm.Dispatch(mgpp::ao::MakeEvent<mgpp::ao::Event>(sig));
+  }
+
+  TestStaticHsm hsm;
+};
+
+TEST_F(StaticHsmTest, Init) {
+  const std::vector<StateRecord> records = {
+      {TOP, mgpp::ao::ENTRY_SIG}, {TOP, mgpp::ao::INIT_SIG},
+      {S1, mgpp::ao::ENTRY_SIG},  {S2, mgpp::ao::ENTRY_SIG},
+      {S3, mgpp::ao::ENTRY_SIG},  {S3, mgpp::ao::INIT_SIG}};
+  EXPECT_EQ(records, hsm.records_);
+  EXPECT_TRUE(hsm.IsIn<S3State>());
+}
+
+TEST_F(StaticHsmTest, TransitionToSelf) {
+  Dispatch(A_SIG);
+  const std::vector<StateRecord> records = {{S3, A_SIG},
+                                            {S3, mgpp::ao::EXIT_SIG},
+                                            {S3, mgpp::ao::ENTRY_SIG},
+                                            {S3, mgpp::ao::INIT_SIG}};
+  EXPECT_EQ(records, hsm.records_);
+  EXPECT_TRUE(hsm.IsIn<S3State>());
+}
+
+TEST_F(StaticHsmTest, TransitionToChild) {
+  Dispatch(B_SIG);
+  const std::vector<StateRecord> records = {
+      {S3, B_SIG}, {S4, mgpp::ao::ENTRY_SIG}, {S4, mgpp::ao::INIT_SIG}};
+  EXPECT_EQ(records, hsm.records_);
+  EXPECT_TRUE(hsm.IsIn<S4State>());
+}
+
+TEST_F(StaticHsmTest, TransitionToSibling) {
+  Dispatch(C_SIG);
+  const std::vector<StateRecord> records = {{S3, C_SIG},
+                                            {S3, mgpp::ao::EXIT_SIG},
+                                            {S7, mgpp::ao::ENTRY_SIG},
+                                            {S7, mgpp::ao::INIT_SIG}};
+  EXPECT_EQ(records, hsm.records_);
+  EXPECT_TRUE(hsm.IsIn<S7State>());
+}
+
+TEST_F(StaticHsmTest, TransitionToParent) {
+  Dispatch(D_SIG);
+  const std::vector<StateRecord> records = {
+      {S3, D_SIG}, {S3, mgpp::ao::EXIT_SIG}, {S2, mgpp::ao::INIT_SIG}};
+  EXPECT_EQ(records, hsm.records_);
+  EXPECT_TRUE(hsm.IsIn<S2State>());
+}
+
+TEST_F(StaticHsmTest, TransitionToNestedInitial) {
+  Dispatch(G_SIG);
+  const std::vector<StateRecord> records = {
+      {S3, G_SIG},               {S3, mgpp::ao::EXIT_SIG},
+      {S2, mgpp::ao::EXIT_SIG},  {S1, mgpp::ao::EXIT_SIG},
+      {S11, mgpp::ao::ENTRY_SIG}, {S12, mgpp::ao::ENTRY_SIG},
+      {S13, mgpp::ao::ENTRY_SIG}, {S13, mgpp::ao::INIT_SIG},
+      {S14, mgpp::ao::ENTRY_SIG}, {S14, mgpp::ao::INIT_SIG}};
+  EXPECT_EQ(records, hsm.records_);
+  EXPECT_TRUE(hsm.IsIn<S14State>());
+}
+
+TEST_F(StaticHsmTest, TransitionFromSuperState) {
+  // S3 handles F while S6 is active, so S6..S4 are exited first
+  Dispatch(E_SIG);
+  Dispatch(F_SIG);
+  const std::vector<StateRecord> records = {
+      {S3, F_SIG},               {S6, mgpp::ao::EXIT_SIG},
+      {S5, mgpp::ao::EXIT_SIG},  {S4, mgpp::ao::EXIT_SIG},
+      {S3, mgpp::ao::EXIT_SIG},  {S7, mgpp::ao::ENTRY_SIG},
+      {S8, mgpp::ao::ENTRY_SIG}, {S9, mgpp::ao::ENTRY_SIG},
+      {S10, mgpp::ao::ENTRY_SIG}, {S10, mgpp::ao::INIT_SIG}};
+  EXPECT_EQ(records, hsm.records_);
+  EXPECT_TRUE(hsm.IsIn<S10State>());
+}
+
+TEST_F(StaticHsmTest, TransitionToAncestor) {
+  Dispatch(E_SIG);
+  Dispatch(H_SIG);
+  const std::vector<StateRecord> records = {
+      {S6, H_SIG},              {S6, mgpp::ao::EXIT_SIG},
+      {S5, mgpp::ao::EXIT_SIG}, {S4, mgpp::ao::EXIT_SIG},
+      {S3, mgpp::ao::EXIT_SIG}, {S2, mgpp::ao::EXIT_SIG},
+      {S1, mgpp::ao::INIT_SIG}};
+  EXPECT_EQ(records, hsm.records_);
+  EXPECT_TRUE(hsm.IsIn<S1State>());
+}
+
+TEST_F(StaticHsmTest, IgnoreUnhandledEvent) {
+  Dispatch(H_SIG);
+  EXPECT_TRUE(hsm.records_.empty());
+  EXPECT_TRUE(hsm.IsIn<S3State>());
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <mgpp/ao.hpp>
+
+#include "recording_hsm.hpp"
+
+enum TimeEventTestSignal {
+  TIMEOUT_SIG = mgpp::ao::USER_SIG,
+  PERIODIC_SIG,
+  FAR_SIG
+};
+
+class TimeEventTest : public ::testing::Test {
+ protected:
+  TimeEventTest()
+      : hsm_(new RecordingHsm()),
+        active_(std::unique_ptr<mgpp::ao::Hsm>(hsm_), 1024) {
+    active_.Start();
+  }
+
+  void Tick(int ticks) {
+    for (int i = 0; i < ticks; ++i) {
+      wheel_.Tick();
+    }
+  }
+
+  // Stop the active object so its records can be read
+  const std::vector<int> &Received() {
+    active_.Stop();
+    return hsm_->signals_;
+  }
+
+  mgpp::ao::TimerWheel wheel_;
+  RecordingHsm *hsm_;
+  mgpp::ao::Active active_;
+};
+
+TEST_F(TimeEventTest, OneShot) {
+  mgpp::ao::TimeEvent timeout(TIMEOUT_SIG, &active_, &wheel_);
+  timeout.Arm(5);
+
+  Tick(4);
+  EXPECT_TRUE(timeout.armed());
+  Tick(1);
+  EXPECT_FALSE(timeout.armed());
+  Tick(100);
+
+  EXPECT_EQ(std::vector<int>({TIMEOUT_SIG}), Received());
+}
+
+TEST_F(TimeEventTest, Periodic) {
+  mgpp::ao::TimeEvent periodic(PERIODIC_SIG, &active_, &wheel_);
+  periodic.Arm(10, 10);
+
+  Tick(1000);
+  EXPECT_TRUE(periodic.armed());
+  EXPECT_TRUE(periodic.Disarm());
+  Tick(100);
+
+  EXPECT_EQ(std::vector<int>(100, PERIODIC_SIG), Received());
+}
+
+TEST_F(TimeEventTest, DisarmAndRearm) {
+  mgpp::ao::TimeEvent timeout(TIMEOUT_SIG, &active_, &wheel_);
+  EXPECT_FALSE(timeout.Disarm());
+
+  timeout.Arm(5);
+  EXPECT_TRUE(timeout.Disarm());
+  Tick(10);
+
+  // Rearming pushes the timeout back
+  EXPECT_FALSE(timeout.Rearm(5));
+  Tick(4);
+  EXPECT_TRUE(timeout.Rearm(5));
+  Tick(4);
+  EXPECT_TRUE(timeout.armed());
+  Tick(1);
+  EXPECT_FALSE(timeout.armed());
+
+  EXPECT_EQ(std::vector<int>({TIMEOUT_SIG}), Received());
+}
+
+TEST_F(TimeEventTest, CascadesFromOuterLevels) {
+  // Land in the third level and in the second level of the wheel
+  mgpp::ao::TimeEvent far(FAR_SIG, &active_, &wheel_);
+  mgpp::ao::TimeEvent near(TIMEOUT_SIG, &active_, &wheel_);
+  Tick(123);
+  far.Arm(70000);
+  near.Arm(300);
+
+  Tick(299);
+  EXPECT_TRUE(near.armed());
+  Tick(1);
+  EXPECT_FALSE(near.armed());
+
+  Tick(70000 - 301);
+  EXPECT_TRUE(far.armed());
+  Tick(1);
+  EXPECT_FALSE(far.armed());
+  EXPECT_EQ(123u + 70000u, wheel_.now());
+
+  EXPECT_EQ(std::vector<int>({TIMEOUT_SIG, FAR_SIG}), Received());
+}
+
+TEST_F(TimeEventTest, ManyArmed) {
+  std::vector<std::unique_ptr<mgpp::ao::TimeEvent>> events;
+  for (int i = 1; i <= 600; ++i) {
+    events.emplace_back(
+        new mgpp::ao::TimeEvent(TIMEOUT_SIG, &active_, &wheel_));
+    events.back()->Arm(i);
+  }
+  for (int i = 1; i <= 600; ++i) {
+    Tick(1);
+    EXPECT_FALSE(events[i - 1]->armed());
+    if (i < 600) {
+      EXPECT_TRUE(events[i]->armed());
+    }
+  }
+
+  EXPECT_EQ(600u, Received().size());
+}
+
+TEST_F(TimeEventTest, TicksFromOwnThread) {
+  mgpp::ao::TimeEvent timeout(TIMEOUT_SIG, &active_, &wheel_);
+  timeout.Arm(2);
+  wheel_.Start(std::chrono::milliseconds(1));
+  while (timeout.armed()) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  wheel_.Stop();
+
+  EXPECT_EQ(std::vector<int>({TIMEOUT_SIG}), Received());
+}
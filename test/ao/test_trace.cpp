@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <mgpp/ao.hpp>
+
+enum TraceTestSignal { SWITCH_SIG = mgpp::ao::USER_SIG, IGNORED_SIG };
+
+class TracedHsm : public mgpp::ao::Hsm {
+ public:
+  TracedHsm() : mgpp::ao::Hsm(mgpp::ao::StateCast(A)) {}
+
+  static mgpp::ao::StateAction Parent(TracedHsm *const me,
+                                      const mgpp::ao::EventConstPtr &evt) {
+    switch (evt->id()) {
+      case mgpp::ao::ENTRY_SIG:
+      case mgpp::ao::EXIT_SIG:
+        return me->Handled();
+    }
+    return me->Super(mgpp::ao::Hsm::Top);
+  }
+
+  static mgpp::ao::StateAction A(TracedHsm *const me,
+                                 const mgpp::ao::EventConstPtr &evt) {
+    switch (evt->id()) {
+      case mgpp::ao::ENTRY_SIG:
+      case mgpp::ao::EXIT_SIG:
+        return me->Handled();
+      case SWITCH_SIG:
+        return me->Transition(B);
+    }
+    return me->Super(Parent);
+  }
+
+  static mgpp::ao::StateAction B(TracedHsm *const me,
+                                 const mgpp::ao::EventConstPtr &evt) {
+    switch (evt->id()) {
+      case mgpp::ao::ENTRY_SIG:
+      case mgpp::ao::EXIT_SIG:
+        return me->Handled();
+    }
+    return me->Super(Parent);
+  }
+};
+
+// Drain whatever earlier tests left buffered
+static std::vector<mgpp::ao::TraceRecord> Drain() {
+  std::vector<mgpp::ao::TraceRecord> records(1 << 16);
+  records.resize(mgpp::ao::DrainTrace(records.data(), records.size()));
+  return records;
+}
+
+template <class T>
+static std::uint64_t Address(T state) {
+  return reinterpret_cast<std::uintptr_t>(mgpp::ao::StateCast(state));
+}
+
+TEST(Trace, RecordsHsmSteps) {
+  Drain();
+  TracedHsm hsm;
+  hsm.Init();
+  hsm.Dispatch(mgpp::ao::MakeEvent<mgpp::ao::Event>(SWITCH_SIG));
+  hsm.Dispatch(mgpp::ao::MakeEvent<mgpp::ao::Event>(IGNORED_SIG));
+
+  struct Step {
+    mgpp::ao::TraceRecordType type;
+    std::uint64_t state;
+    int signal;
+  };
+  const std::vector<Step> expected = {
+      {mgpp::ao::TRACE_INIT, Address(TracedHsm::A), -1},
+      {mgpp::ao::TRACE_ENTRY, Address(TracedHsm::Parent),
+       mgpp::ao::ENTRY_SIG},
+      {mgpp::ao::TRACE_ENTRY, Address(TracedHsm::A), mgpp::ao::ENTRY_SIG},
+      {mgpp::ao::TRACE_DISPATCH, Address(TracedHsm::A), SWITCH_SIG},
+      {mgpp::ao::TRACE_TRANSITION, Address(TracedHsm::B), -1},
+      {mgpp::ao::TRACE_EXIT, Address(TracedHsm::A), mgpp::ao::EXIT_SIG},
+      {mgpp::ao::TRACE_ENTRY, Address(TracedHsm::B), mgpp::ao::ENTRY_SIG},
+      {mgpp::ao::TRACE_DISPATCH, Address(TracedHsm::B), IGNORED_SIG},
+  };
+
+  const std::vector<mgpp::ao::TraceRecord> records = Drain();
+  ASSERT_EQ(expected.size(), records.size());
+  for (std::size_t i = 0; i < records.size(); ++i) {
+    EXPECT_EQ(expected[i].type, records[i].type) << i;
+    EXPECT_EQ(expected[i].state, records[i].state) << i;
+    EXPECT_EQ(expected[i].signal, records[i].signal) << i;
+    EXPECT_EQ(reinterpret_cast<std::uintptr_t>(&hsm), records[i].object);
+    EXPECT_EQ(records[0].thread, records[i].thread);
+    if (i > 0) {
+      EXPECT_LE(records[i - 1].timestamp, records[i].timestamp);
+    }
+  }
+}
+
+TEST(Trace, FullBufferDropsRecords) {
+  Drain();
+  const std::uint64_t dropped = mgpp::ao::TraceDropped();
+  for (int i = 0; i < MGPP_AO_TRACE_BUFFER + 10; ++i) {
+    mgpp::ao::TraceEvent(mgpp::ao::TRACE_DISPATCH, nullptr, nullptr, i);
+  }
+  EXPECT_EQ(dropped + 10, mgpp::ao::TraceDropped());
+
+  const std::vector<mgpp::ao::TraceRecord> records = Drain();
+  ASSERT_EQ(static_cast<std::size_t>(MGPP_AO_TRACE_BUFFER), records.size());
+  EXPECT_EQ(0, records.front().signal);
+  EXPECT_EQ(MGPP_AO_TRACE_BUFFER - 1, records.back().signal);
+}
+
+TEST(Trace, ThreadsRecordIntoOwnBuffers) {
+  Drain();
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([]() {
+      for (int i = 0; i < 100; ++i) {
+        mgpp::ao::TraceEvent(mgpp::ao::TRACE_DISPATCH, nullptr, nullptr, i);
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Each thread's records stay in order, and the buffers of the exited
+  // threads are released once drained
+  const std::vector<mgpp::ao::TraceRecord> records = Drain();
+  ASSERT_EQ(400u, records.size());
+  for (std::size_t i = 1; i < records.size(); ++i) {
+    if (records[i].thread == records[i - 1].thread) {
+      EXPECT_EQ(records[i - 1].signal + 1, records[i].signal);
+    }
+  }
+  EXPECT_TRUE(Drain().empty());
+}
+
+TEST(Trace, FlushesToFile) {
+  Drain();
+  const std::string path = ::testing::TempDir() + "mgpp_trace_test.bin";
+  {
+    mgpp::ao::TraceFile file(path, 4);
+    for (int i = 0; i < 6; ++i) {
+      mgpp::ao::TraceEvent(mgpp::ao::TRACE_ENTRY, &file, nullptr, i);
+    }
+    EXPECT_EQ(4u, file.Flush());
+    EXPECT_EQ(0u, file.Flush());
+    EXPECT_EQ(4u, file.size());
+  }
+
+  const std::vector<mgpp::ao::TraceRecord> records =
+      mgpp::ao::ReadTrace(path);
+  ASSERT_EQ(4u, records.size());
+  for (int i = 0; i < 4; ++i) {
+    EXPECT_EQ(i, records[i].signal);
+    EXPECT_EQ(mgpp::ao::TRACE_ENTRY, records[i].type);
+  }
+
+  // What did not fit is still buffered
+  EXPECT_EQ(2u, Drain().size());
+  std::remove(path.c_str());
+}
+
+TEST(Trace, FileWithoutSpaceThrows) {
+  EXPECT_THROW(mgpp::ao::TraceFile("/dev/full", 4), std::system_error);
+}
+
+TEST(Trace, RejectsOtherFiles) {
+  const std::string path = ::testing::TempDir() + "mgpp_not_a_trace.bin";
+  std::ofstream(path) << "not a trace file at all";
+  EXPECT_THROW(mgpp::ao::ReadTrace(path), std::runtime_error);
+  std::remove(path.c_str());
+  EXPECT_THROW(mgpp::ao::ReadTrace(path), std::runtime_error);
+}
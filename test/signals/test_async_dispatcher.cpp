@@ -0,0 +1,278 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include <mgpp/signals/async_dispatcher.hpp>
+
+enum AsyncTestEvents { SEQ_EVENT, OTHER_EVENT };
+
+class SeqEvent : public mgpp::signals::Event {
+ public:
+  explicit SeqEvent(int seq) : mgpp::signals::Event(SEQ_EVENT), seq_(seq) {}
+  int seq() const { return seq_; }
+
+ private:
+  int seq_;
+};
+
+int Seq(const mgpp::signals::EventConstPtr &event) {
+  return static_cast<const SeqEvent &>(*event).seq();
+}
+
+// Holds a worker inside its callback until opened
+class Gate {
+ public:
+  Gate() : entered_(false), open_(false) {}
+
+  void Wait() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    entered_ = true;
+    cond_.notify_all();
+    while (!open_) {
+      cond_.wait_for(lock, std::chrono::milliseconds(10));
+    }
+  }
+
+  void WaitEntered() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (!entered_) {
+      cond_.wait_for(lock, std::chrono::milliseconds(10));
+    }
+  }
+
+  void Open() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    open_ = true;
+    cond_.notify_all();
+  }
+
+ private:
+  std::mutex mutex_;
+  std::condition_variable cond_;
+  bool entered_;
+  bool open_;
+};
+
+TEST(AsyncDispatcher, Subscribe) {
+  mgpp::signals::AsyncDispatcher dispatcher(2, 16);
+  EXPECT_EQ(0, dispatcher.NumSlots(SEQ_EVENT));
+
+  auto noop = [](const mgpp::signals::EventConstPtr &event) { (void)event; };
+  mgpp::signals::Connection conn = dispatcher.Subscribe(SEQ_EVENT, noop);
+  dispatcher.Subscribe(SEQ_EVENT, noop);
+  dispatcher.Subscribe(OTHER_EVENT, noop);
+  EXPECT_EQ(2, dispatcher.NumSlots(SEQ_EVENT));
+  EXPECT_EQ(1, dispatcher.NumSlots(OTHER_EVENT));
+
+  dispatcher.Unsubscribe(SEQ_EVENT, conn);
+  EXPECT_EQ(1, dispatcher.NumSlots(SEQ_EVENT));
+
+  dispatcher.UnsubscribeAll(SEQ_EVENT);
+  EXPECT_EQ(0, dispatcher.NumSlots(SEQ_EVENT));
+  EXPECT_EQ(1, dispatcher.NumSlots(OTHER_EVENT));
+
+  dispatcher.UnsubscribeAll();
+  EXPECT_EQ(0, dispatcher.NumSlots(OTHER_EVENT));
+}
+
+TEST(AsyncDispatcher, PerSubscriberOrdering) {
+  const int kSubscribers = 8;
+  const int kEvents = 2000;
+
+  mgpp::signals::AsyncDispatcher dispatcher(4, 64);
+  std::vector<std::vector<int>> received(kSubscribers);
+  for (int i = 0; i < kSubscribers; ++i) {
+    std::vector<int> *seqs = &received[i];
+    dispatcher.Subscribe(
+        SEQ_EVENT, [seqs](const mgpp::signals::EventConstPtr &event) {
+          seqs->push_back(Seq(event));
+        });
+  }
+
+  for (int seq = 0; seq < kEvents; ++seq) {
+    EXPECT_TRUE(dispatcher.Publish(mgpp::signals::MakeEvent<SeqEvent>(seq)));
+  }
+  dispatcher.Drain();
+
+  for (auto &seqs : received) {
+    ASSERT_EQ(static_cast<std::size_t>(kEvents), seqs.size());
+    for (int seq = 0; seq < kEvents; ++seq) {
+      EXPECT_EQ(seq, seqs[seq]);
+    }
+  }
+
+  mgpp::signals::AsyncMetrics metrics = dispatcher.metrics();
+  EXPECT_EQ(static_cast<std::uint64_t>(kEvents), metrics.published);
+  EXPECT_EQ(static_cast<std::uint64_t>(4 * kEvents), metrics.delivered);
+  EXPECT_EQ(0u, metrics.dropped);
+  EXPECT_EQ(0u, metrics.depth);
+}
+
+TEST(AsyncDispatcher, DropNewest) {
+  mgpp::signals::AsyncDispatcher dispatcher(
+      1, 4, mgpp::signals::BACKPRESSURE_DROP_NEWEST);
+  Gate gate;
+  std::vector<int> seqs;
+  dispatcher.Subscribe(
+      SEQ_EVENT, [&gate, &seqs](const mgpp::signals::EventConstPtr &event) {
+        if (seqs.empty()) {
+          gate.Wait();
+        }
+        seqs.push_back(Seq(event));
+      });
+
+  // The worker holds event 0, events 1-4 fill the queue
+  dispatcher.Publish(mgpp::signals::MakeEvent<SeqEvent>(0));
+  gate.WaitEntered();
+  for (int seq = 1; seq <= 4; ++seq) {
+    EXPECT_TRUE(dispatcher.Publish(mgpp::signals::MakeEvent<SeqEvent>(seq)));
+  }
+  EXPECT_FALSE(dispatcher.Publish(mgpp::signals::MakeEvent<SeqEvent>(5)));
+
+  mgpp::signals::AsyncMetrics metrics = dispatcher.metrics();
+  EXPECT_EQ(4u, metrics.depth);
+  EXPECT_EQ(4u, metrics.high_water);
+  EXPECT_EQ(1u, metrics.dropped);
+
+  gate.Open();
+  dispatcher.Drain();
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4}), seqs);
+}
+
+TEST(AsyncDispatcher, DropNewestPartialFanOut) {
+  mgpp::signals::AsyncDispatcher dispatcher(
+      2, 2, mgpp::signals::BACKPRESSURE_DROP_NEWEST);
+  Gate gate;
+  std::vector<int> blocked;
+  std::vector<int> free;
+  // Subscribers are pinned round-robin, one per worker
+  dispatcher.Subscribe(
+      SEQ_EVENT, [&gate, &blocked](const mgpp::signals::EventConstPtr &event) {
+        if (blocked.empty()) {
+          gate.Wait();
+        }
+        blocked.push_back(Seq(event));
+      });
+  dispatcher.Subscribe(SEQ_EVENT,
+                       [&free](const mgpp::signals::EventConstPtr &event) {
+                         free.push_back(Seq(event));
+                       });
+
+  // The first worker holds event 0 and queues events 1-2; the second worker
+  // delivers each before the next is published
+  for (int seq = 0; seq <= 2; ++seq) {
+    EXPECT_TRUE(dispatcher.Publish(mgpp::signals::MakeEvent<SeqEvent>(seq)));
+    const std::uint64_t delivered = seq + 1;
+    while (dispatcher.metrics().delivered < delivered) {
+      std::this_thread::yield();
+    }
+  }
+  gate.WaitEntered();
+
+  // Only the first worker's queue is full
+  EXPECT_FALSE(dispatcher.Publish(mgpp::signals::MakeEvent<SeqEvent>(3)));
+
+  mgpp::signals::AsyncMetrics metrics = dispatcher.metrics();
+  EXPECT_EQ(4u, metrics.published);
+  EXPECT_EQ(1u, metrics.dropped);
+
+  gate.Open();
+  dispatcher.Drain();
+  EXPECT_EQ(std::vector<int>({0, 1, 2}), blocked);
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3}), free);
+  EXPECT_EQ(7u, dispatcher.metrics().delivered);
+}
+
+TEST(AsyncDispatcher, DropOldest) {
+  mgpp::signals::AsyncDispatcher dispatcher(
+      1, 4, mgpp::signals::BACKPRESSURE_DROP_OLDEST);
+  Gate gate;
+  std::vector<int> seqs;
+  dispatcher.Subscribe(
+      SEQ_EVENT, [&gate, &seqs](const mgpp::signals::EventConstPtr &event) {
+        if (seqs.empty()) {
+          gate.Wait();
+        }
+        seqs.push_back(Seq(event));
+      });
+
+  dispatcher.Publish(mgpp::signals::MakeEvent<SeqEvent>(0));
+  gate.WaitEntered();
+  for (int seq = 1; seq <= 5; ++seq) {
+    EXPECT_TRUE(dispatcher.Publish(mgpp::signals::MakeEvent<SeqEvent>(seq)));
+  }
+  EXPECT_EQ(1u, dispatcher.metrics().dropped);
+
+  gate.Open();
+  dispatcher.Drain();
+  EXPECT_EQ(std::vector<int>({0, 2, 3, 4, 5}), seqs);
+}
+
+TEST(AsyncDispatcher, Block) {
+  mgpp::signals::AsyncDispatcher dispatcher(1, 2,
+                                            mgpp::signals::BACKPRESSURE_BLOCK);
+  Gate gate;
+  std::vector<int> seqs;
+  dispatcher.Subscribe(
+      SEQ_EVENT, [&gate, &seqs](const mgpp::signals::EventConstPtr &event) {
+        if (seqs.empty()) {
+          gate.Wait();
+        }
+        seqs.push_back(Seq(event));
+      });
+
+  dispatcher.Publish(mgpp::signals::MakeEvent<SeqEvent>(0));
+  gate.WaitEntered();
+
+  // The publisher blocks once the queue is full, until the worker drains it
+  std::atomic<int> published(0);
+  std::thread publisher([&dispatcher, &published]() {
+    for (int seq = 1; seq <= 10; ++seq) {
+      dispatcher.Publish(mgpp::signals::MakeEvent<SeqEvent>(seq));
+      published++;
+    }
+  });
+  while (dispatcher.metrics().depth < 2) {
+    std::this_thread::yield();
+  }
+  EXPECT_LT(published, 10);
+
+  gate.Open();
+  publisher.join();
+  dispatcher.Drain();
+
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10}), seqs);
+  EXPECT_EQ(0u, dispatcher.metrics().dropped);
+}
@@ -0,0 +1,230 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <set>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include <mgpp/signals/event.hpp>
+
+class SmallEvent : public mgpp::signals::Event {
+ public:
+  explicit SmallEvent(int arg) : mgpp::signals::Event(arg), arg_(arg) {}
+  int arg() const { return arg_; }
+
+ private:
+  int arg_;
+};
+
+class LargeEvent : public mgpp::signals::Event {
+ public:
+  explicit LargeEvent(int id) : mgpp::signals::Event(id), payload_() {}
+
+ private:
+  char payload_[4096];
+};
+
+// Events whose Event base is not at the start of the object
+struct Mixin {
+  virtual ~Mixin() {}
+  long tag[3] = {1, 2, 3};
+};
+
+template <std::size_t Size>
+class MixinEvent : public Mixin, public mgpp::signals::Event {
+ public:
+  explicit MixinEvent(int id) : mgpp::signals::Event(id), payload_() {}
+
+ private:
+  char payload_[Size];
+};
+
+// Event needing more than the pools' alignment
+class alignas(128) AlignedEvent : public mgpp::signals::Event {
+ public:
+  explicit AlignedEvent(int id) : mgpp::signals::Event(id) {}
+};
+
+// Metrics of the pool serving events of type T
+template <typename T>
+mgpp::signals::PoolMetrics Metrics() {
+  const std::size_t size = sizeof(T);
+  for (auto &metrics : mgpp::signals::EventPoolMetrics()) {
+    if (size < metrics.block_size) {
+      return metrics;
+    }
+  }
+  return mgpp::signals::PoolMetrics();
+}
+
+TEST(EventPool, SizeClasses) {
+  std::vector<mgpp::signals::PoolMetrics> pools(
+      mgpp::signals::EventPoolMetrics());
+  ASSERT_EQ(5u, pools.size());
+  EXPECT_EQ(64u, pools.front().block_size);
+  EXPECT_EQ(1024u, pools.back().block_size);
+}
+
+TEST(EventPool, RecyclesBlocks) {
+  const std::size_t kEvents = 10000;
+  const mgpp::signals::PoolMetrics before = Metrics<SmallEvent>();
+
+  std::vector<mgpp::signals::EventRef<SmallEvent>> events;
+  std::set<const void *> addresses;
+  for (std::size_t i = 0; i < kEvents; ++i) {
+    events.push_back(mgpp::signals::MakeEvent<SmallEvent>(static_cast<int>(i)));
+    addresses.insert(events.back().get());
+  }
+  EXPECT_EQ(kEvents, addresses.size());
+  for (std::size_t i = 0; i < kEvents; ++i) {
+    EXPECT_EQ(static_cast<int>(i), events[i]->arg());
+  }
+
+  // Blocks cached by this thread count as in use too
+  const mgpp::signals::PoolMetrics during = Metrics<SmallEvent>();
+  EXPECT_LE(before.in_use + kEvents, during.in_use);
+  EXPECT_LE(during.in_use, during.high_water);
+  EXPECT_LE(during.in_use, during.capacity);
+
+  // Freed blocks are reused rather than growing the pool again
+  events.clear();
+  for (std::size_t i = 0; i < kEvents; ++i) {
+    events.push_back(mgpp::signals::MakeEvent<SmallEvent>(static_cast<int>(i)));
+  }
+  events.clear();
+
+  const mgpp::signals::PoolMetrics after = Metrics<SmallEvent>();
+  EXPECT_GT(during.in_use, after.in_use);
+  EXPECT_EQ(during.capacity, after.capacity);
+  EXPECT_EQ(during.high_water, after.high_water);
+}
+
+TEST(EventPool, LargeEventsUseHeap) {
+  std::vector<mgpp::signals::PoolMetrics> before(
+      mgpp::signals::EventPoolMetrics());
+  mgpp::signals::EventRef<LargeEvent> evt(
+      mgpp::signals::MakeEvent<LargeEvent>(7));
+  EXPECT_EQ(7, evt->id());
+
+  std::vector<mgpp::signals::PoolMetrics> after(
+      mgpp::signals::EventPoolMetrics());
+  for (std::size_t i = 0; i < before.size(); ++i) {
+    EXPECT_EQ(before[i].in_use, after[i].in_use);
+  }
+}
+
+TEST(EventPool, OverAlignedEventsUseAlignedHeap) {
+  std::vector<mgpp::signals::EventRef<AlignedEvent>> events;
+  for (int i = 0; i < 16; ++i) {
+    events.push_back(mgpp::signals::MakeEvent<AlignedEvent>(i));
+    EXPECT_EQ(0u, reinterpret_cast<std::uintptr_t>(events.back().get()) %
+                      alignof(AlignedEvent));
+  }
+}
+
+TEST(EventPool, EventBaseNotFirst) {
+  using SmallMixin = MixinEvent<8>;
+  const void *block;
+  {
+    mgpp::signals::EventRef<SmallMixin> evt(
+        mgpp::signals::MakeEvent<SmallMixin>(1));
+    ASSERT_NE(static_cast<const void *>(evt.get()),
+              static_cast<const mgpp::signals::Event *>(evt.get()));
+    block = evt.get();
+  }
+
+  // The block went back whole, so it is handed out again as is
+  mgpp::signals::EventRef<SmallMixin> evt(
+      mgpp::signals::MakeEvent<SmallMixin>(2));
+  EXPECT_EQ(block, evt.get());
+
+  // Heap blocks are freed at the address they were allocated at
+  mgpp::signals::EventConstPtr large(
+      mgpp::signals::MakeEvent<MixinEvent<4096>>(3));
+  EXPECT_EQ(3, large->id());
+  large = nullptr;
+}
+
+TEST(EventPool, ConcurrentAllocateAndFree) {
+  const std::size_t in_use = Metrics<SmallEvent>().in_use;
+  const int kThreads = 4;
+  const int kRounds = 200;
+  const int kBatch = 100;
+
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([i]() {
+      std::vector<mgpp::signals::EventRef<SmallEvent>> events;
+      for (int round = 0; round < kRounds; ++round) {
+        for (int j = 0; j < kBatch; ++j) {
+          events.push_back(mgpp::signals::MakeEvent<SmallEvent>(i));
+        }
+        for (auto &evt : events) {
+          EXPECT_EQ(i, evt->arg());
+        }
+        events.clear();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  // Exiting threads hand their cached blocks back
+  EXPECT_EQ(in_use, Metrics<SmallEvent>().in_use);
+}
+
+// Flags its destruction
+class TrackedEvent : public mgpp::signals::Event {
+ public:
+  explicit TrackedEvent(bool *destroyed)
+      : mgpp::signals::Event(0), destroyed_(destroyed) {}
+  ~TrackedEvent() { *destroyed_ = true; }
+
+ private:
+  bool *destroyed_;
+};
+
+TEST(EventRef, DestroysOnLastRelease) {
+  bool destroyed = false;
+  mgpp::signals::EventRef<TrackedEvent> evt(
+      mgpp::signals::MakeEvent<TrackedEvent>(&destroyed));
+
+  mgpp::signals::EventConstPtr base(evt);
+  EXPECT_TRUE(base == evt);
+  mgpp::signals::EventConstPtr moved(std::move(base));
+  EXPECT_TRUE(base == nullptr);
+  EXPECT_TRUE(moved == evt);
+
+  evt.reset();
+  EXPECT_FALSE(destroyed);
+  moved = nullptr;
+  EXPECT_TRUE(destroyed);
+}
@@ -0,0 +1,226 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <vector>
+
+#include <mgpp/signals.hpp>
+
+enum FilterTestEvent { READING_EVENT = 1, OTHER_EVENT };
+
+class Reading : public mgpp::signals::Event {
+ public:
+  Reading(int sensor, double value)
+      : mgpp::signals::Event(READING_EVENT), sensor_(sensor), value_(value) {}
+
+  int sensor() const { return sensor_; }
+  double value() const { return value_; }
+
+ private:
+  int sensor_;
+  double value_;
+};
+
+// Events whose getters are virtual and sit at the same vtable offset
+class Alpha : public mgpp::signals::Event {
+ public:
+  Alpha() : mgpp::signals::Event(OTHER_EVENT) {}
+  virtual int alpha() const { return 1; }
+};
+
+class Beta : public mgpp::signals::Event {
+ public:
+  Beta() : mgpp::signals::Event(OTHER_EVENT) {}
+  virtual int beta() const { return 2; }
+};
+
+class FilterTest : public ::testing::Test {
+ protected:
+  void TearDown() override { mgpp::signals::UnsubscribeAll(); }
+
+  void Publish(int sensor, double value) {
+    mgpp::signals::Publish(mgpp::signals::MakeEvent<Reading>(sensor, value));
+  }
+
+  // Slot recording the sensors of the readings it gets into `sensors`
+  static mgpp::signals::EventCallback Record(std::vector<int> *sensors) {
+    return [sensors](const mgpp::signals::EventConstPtr &event) {
+      sensors->push_back(static_cast<const Reading &>(*event).sensor());
+    };
+  }
+};
+
+class ReadingListener {
+ public:
+  void OnReading(const mgpp::signals::EventConstPtr &event) {
+    sensors.push_back(static_cast<const Reading &>(*event).sensor());
+  }
+
+  std::vector<int> sensors;
+};
+
+TEST_F(FilterTest, FieldFilters) {
+  std::vector<int> hot;
+  std::vector<int> sensor_two;
+  std::vector<int> all;
+  mgpp::signals::Subscribe(
+      READING_EVENT,
+      mgpp::signals::EventFilter::Range(&Reading::value, 30.0, 50.0),
+      Record(&hot));
+  mgpp::signals::Subscribe(
+      READING_EVENT, mgpp::signals::EventFilter::Equal(&Reading::sensor, 2),
+      Record(&sensor_two));
+  mgpp::signals::Subscribe(READING_EVENT, Record(&all));
+
+  Publish(1, 20.0);
+  Publish(2, 30.0);
+  Publish(3, 50.0);
+  Publish(4, 50.5);
+
+  EXPECT_EQ(std::vector<int>({2, 3}), hot);
+  EXPECT_EQ(std::vector<int>({2}), sensor_two);
+  EXPECT_EQ(std::vector<int>({1, 2, 3, 4}), all);
+}
+
+TEST_F(FilterTest, EqualFiltersShareOneCheck) {
+  int checks = 0;
+  const mgpp::signals::EventFilter odd(
+      [&checks](const mgpp::signals::Event &event) {
+        ++checks;
+        return static_cast<const Reading &>(event).sensor() % 2 == 1;
+      });
+  std::vector<int> first;
+  std::vector<int> second;
+  mgpp::signals::Subscribe(READING_EVENT, odd, Record(&first));
+  mgpp::signals::Subscribe(READING_EVENT, odd, Record(&second));
+  EXPECT_EQ(1, mgpp::signals::NumSlots(READING_EVENT));
+
+  for (int sensor = 0; sensor < 4; ++sensor) {
+    Publish(sensor, 0.0);
+  }
+  EXPECT_EQ(4, checks);
+  EXPECT_EQ(std::vector<int>({1, 3}), first);
+  EXPECT_EQ(std::vector<int>({1, 3}), second);
+}
+
+TEST_F(FilterTest, FieldFilterKeys) {
+  using mgpp::signals::EventFilter;
+  EXPECT_TRUE(EventFilter::Equal(&Reading::sensor, 1) ==
+              EventFilter::Range(&Reading::sensor, 1, 1));
+  EXPECT_FALSE(EventFilter::Equal(&Reading::sensor, 1) ==
+               EventFilter::Equal(&Reading::sensor, 2));
+
+  const auto any = [](const mgpp::signals::Event &) { return true; };
+  const EventFilter predicate(any);
+  EXPECT_TRUE(predicate == EventFilter(predicate));
+  EXPECT_FALSE(predicate == EventFilter(any));
+
+  std::vector<int> sensors;
+  mgpp::signals::Subscribe(READING_EVENT,
+                           EventFilter::Equal(&Reading::sensor, 1),
+                           Record(&sensors));
+  mgpp::signals::Subscribe(READING_EVENT,
+                           EventFilter::Equal(&Reading::sensor, 1),
+                           Record(&sensors));
+  mgpp::signals::Subscribe(READING_EVENT,
+                           EventFilter::Equal(&Reading::sensor, 2),
+                           Record(&sensors));
+  EXPECT_EQ(2, mgpp::signals::NumSlots(READING_EVENT));
+}
+
+TEST_F(FilterTest, VirtualGettersOfOtherEventsDiffer) {
+  using mgpp::signals::EventFilter;
+  EXPECT_FALSE(EventFilter::Range(&Alpha::alpha, 0, 10) ==
+               EventFilter::Range(&Beta::beta, 0, 10));
+  EXPECT_FALSE(EventFilter::Equal(&Reading::sensor, 1) ==
+               EventFilter::Equal(&Reading::sensor, 1L));
+
+  // Each gets a group of its own rather than sharing one check
+  std::vector<int> sensors;
+  mgpp::signals::Subscribe(OTHER_EVENT,
+                           EventFilter::Range(&Alpha::alpha, 0, 10),
+                           Record(&sensors));
+  mgpp::signals::Subscribe(OTHER_EVENT,
+                           EventFilter::Range(&Beta::beta, 0, 10),
+                           Record(&sensors));
+  EXPECT_EQ(2, mgpp::signals::NumSlots(OTHER_EVENT));
+}
+
+TEST_F(FilterTest, Unsubscribe) {
+  const mgpp::signals::EventFilter sensor_one =
+      mgpp::signals::EventFilter::Equal(&Reading::sensor, 1);
+  std::vector<int> first;
+  std::vector<int> second;
+  const mgpp::signals::Connection conn1 =
+      mgpp::signals::Subscribe(READING_EVENT, sensor_one, Record(&first));
+  const mgpp::signals::Connection conn2 =
+      mgpp::signals::Subscribe(READING_EVENT, sensor_one, Record(&second));
+
+  mgpp::signals::Unsubscribe(READING_EVENT, conn1);
+  EXPECT_EQ(1, mgpp::signals::NumSlots(READING_EVENT));
+  Publish(1, 0.0);
+  EXPECT_TRUE(first.empty());
+  EXPECT_EQ(std::vector<int>({1}), second);
+
+  // The group goes with its last slot
+  mgpp::signals::Unsubscribe(READING_EVENT, conn2);
+  EXPECT_EQ(0, mgpp::signals::NumSlots(READING_EVENT));
+  Publish(1, 0.0);
+  EXPECT_EQ(std::vector<int>({1}), second);
+
+  // Subscribing again starts a new group
+  mgpp::signals::Subscribe(READING_EVENT, sensor_one, Record(&first));
+  Publish(1, 0.0);
+  EXPECT_EQ(std::vector<int>({1}), first);
+}
+
+TEST_F(FilterTest, UnsubscribeAllOfId) {
+  std::vector<int> sensors;
+  mgpp::signals::Subscribe(
+      READING_EVENT, mgpp::signals::EventFilter::Equal(&Reading::sensor, 1),
+      Record(&sensors));
+  mgpp::signals::Subscribe(
+      OTHER_EVENT, mgpp::signals::EventFilter::Equal(&Reading::sensor, 1),
+      Record(&sensors));
+
+  mgpp::signals::UnsubscribeAll(READING_EVENT);
+  EXPECT_EQ(0, mgpp::signals::NumSlots(READING_EVENT));
+  EXPECT_EQ(1, mgpp::signals::NumSlots(OTHER_EVENT));
+  Publish(1, 0.0);
+  EXPECT_TRUE(sensors.empty());
+}
+
+TEST_F(FilterTest, MemberCallback) {
+  ReadingListener listener;
+  mgpp::signals::Subscribe(
+      READING_EVENT, mgpp::signals::EventFilter::Range(&Reading::sensor, 2, 3),
+      &ReadingListener::OnReading, listener);
+  for (int sensor = 0; sensor < 5; ++sensor) {
+    Publish(sensor, 0.0);
+  }
+  EXPECT_EQ(std::vector<int>({2, 3}), listener.sensors);
+}
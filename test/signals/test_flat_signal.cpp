@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include <mgpp/signals/flat_signal.hpp>
+
+class FlatSignalTest : public ::testing::Test {
+ protected:
+  mgpp::signals::FlatSignal::Slot Record(int slot) {
+    return [this, slot](const mgpp::signals::EventConstPtr &event) {
+      (void)event;
+      calls_.push_back(slot);
+    };
+  }
+
+  void Invoke() {
+    signal_(mgpp::signals::MakeEvent<mgpp::signals::Event>(0));
+  }
+
+  mgpp::signals::FlatSignal signal_;
+  std::vector<int> calls_;
+};
+
+TEST_F(FlatSignalTest, Defaults) {
+  EXPECT_TRUE(signal_.empty());
+  EXPECT_EQ(0u, signal_.num_slots());
+  Invoke();
+  EXPECT_TRUE(calls_.empty());
+}
+
+TEST_F(FlatSignalTest, InvokeInConnectionOrder) {
+  for (int i = 0; i < 10; ++i) {
+    signal_.connect(Record(i));
+  }
+  EXPECT_EQ(10u, signal_.num_slots());
+
+  Invoke();
+  EXPECT_EQ(std::vector<int>({0, 1, 2, 3, 4, 5, 6, 7, 8, 9}), calls_);
+}
+
+TEST_F(FlatSignalTest, Disconnect) {
+  signal_.connect(Record(0));
+  mgpp::signals::FlatConnection conn = signal_.connect(Record(1));
+  signal_.connect(Record(2));
+
+  EXPECT_TRUE(conn.connected());
+  conn.disconnect();
+  EXPECT_FALSE(conn.connected());
+  EXPECT_EQ(2u, signal_.num_slots());
+
+  // Disconnecting twice is harmless
+  conn.disconnect();
+  EXPECT_EQ(2u, signal_.num_slots());
+
+  Invoke();
+  EXPECT_EQ(std::vector<int>({0, 2}), calls_);
+}
+
+TEST_F(FlatSignalTest, CompactTombstones) {
+  std::vector<mgpp::signals::FlatConnection> conns;
+  for (int i = 0; i < 100; ++i) {
+    conns.push_back(signal_.connect(Record(i)));
+  }
+  for (int i = 0; i < 100; ++i) {
+    if (i % 10 != 0) {
+      conns[i].disconnect();
+    }
+  }
+  EXPECT_EQ(10u, signal_.num_slots());
+
+  Invoke();
+  EXPECT_EQ(std::vector<int>({0, 10, 20, 30, 40, 50, 60, 70, 80, 90}), calls_);
+}
+
+TEST_F(FlatSignalTest, DisconnectAllSlots) {
+  mgpp::signals::FlatConnection conn = signal_.connect(Record(0));
+  signal_.connect(Record(1));
+
+  signal_.disconnect_all_slots();
+  EXPECT_TRUE(signal_.empty());
+  EXPECT_FALSE(conn.connected());
+
+  Invoke();
+  EXPECT_TRUE(calls_.empty());
+}
+
+TEST_F(FlatSignalTest, DisconnectRacingDisconnectAll) {
+  for (int round = 0; round < 200; ++round) {
+    std::vector<mgpp::signals::FlatConnection> conns;
+    for (int i = 0; i < 256; ++i) {
+      conns.push_back(signal_.connect(Record(i)));
+    }
+
+    // Start disconnect_all_slots once the other thread is part way through
+    std::atomic<int> disconnected(0);
+    std::thread disconnector([&conns, &disconnected]() {
+      for (const mgpp::signals::FlatConnection &conn : conns) {
+        conn.disconnect();
+        disconnected++;
+      }
+    });
+    while (disconnected < 8) {
+      std::this_thread::yield();
+    }
+    signal_.disconnect_all_slots();
+    disconnector.join();
+
+    ASSERT_EQ(0u, signal_.num_slots());
+  }
+
+  signal_.connect(Record(0));
+  EXPECT_EQ(1u, signal_.num_slots());
+}
+
+TEST_F(FlatSignalTest, DisconnectDuringInvoke) {
+  mgpp::signals::FlatConnection later;
+  signal_.connect([&later](const mgpp::signals::EventConstPtr &event) {
+    (void)event;
+    later.disconnect();
+  });
+  later = signal_.connect(Record(1));
+
+  Invoke();
+  EXPECT_TRUE(calls_.empty());
+}
+
+TEST_F(FlatSignalTest, ConnectDuringInvoke) {
+  signal_.connect([this](const mgpp::signals::EventConstPtr &event) {
+    (void)event;
+    signal_.connect(Record(1));
+  });
+
+  // Slots connected while invoking are only called on the next invocation
+  Invoke();
+  EXPECT_TRUE(calls_.empty());
+  Invoke();
+  EXPECT_EQ(std::vector<int>({1}), calls_);
+}
+
+TEST(FlatConnection, OutlivesSignal) {
+  mgpp::signals::FlatConnection conn;
+  EXPECT_FALSE(conn.connected());
+  {
+    mgpp::signals::FlatSignal signal;
+    conn = signal.connect([](const mgpp::signals::EventConstPtr &event) {
+      (void)event;
+    });
+    EXPECT_TRUE(conn.connected());
+  }
+  EXPECT_FALSE(conn.connected());
+  conn.disconnect();
+}
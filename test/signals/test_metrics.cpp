@@ -0,0 +1,196 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <mgpp/signals.hpp>
+
+enum MetricsTestEvent { FAST_EVENT = 7, SLOW_EVENT, QUIET_EVENT };
+
+TEST(Histogram, ExactBelowSixteen) {
+  mgpp::signals::Histogram histogram;
+  for (std::uint64_t value = 0; value < 16; ++value) {
+    histogram.Record(value);
+  }
+  EXPECT_EQ(16u, histogram.count());
+  EXPECT_EQ(15u, histogram.max());
+  EXPECT_DOUBLE_EQ(7.5, histogram.mean());
+  EXPECT_EQ(7u, histogram.Percentile(0.5));
+  EXPECT_EQ(15u, histogram.Percentile(1.0));
+}
+
+TEST(Histogram, BucketsWithinAnEighth) {
+  mgpp::signals::Histogram histogram;
+  for (int i = 0; i < 990; ++i) {
+    histogram.Record(1000);
+  }
+  for (int i = 0; i < 10; ++i) {
+    histogram.Record(1000000);
+  }
+
+  const std::uint64_t p50 = histogram.Percentile(0.5);
+  EXPECT_GE(p50, 1000u);
+  EXPECT_LE(p50, 1125u);
+  const std::uint64_t p999 = histogram.Percentile(0.999);
+  EXPECT_GE(p999, 1000000u * 7 / 8);
+  EXPECT_LE(p999, 1000000u);
+  EXPECT_EQ(1000000u, histogram.max());
+
+  histogram.Reset();
+  EXPECT_EQ(0u, histogram.count());
+  EXPECT_EQ(0u, histogram.Percentile(0.5));
+}
+
+TEST(Histogram, ConcurrentRecords) {
+  mgpp::signals::Histogram histogram;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&histogram, t]() {
+      for (int i = 0; i < 10000; ++i) {
+        histogram.Record(static_cast<std::uint64_t>(t * 10000 + i));
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+  EXPECT_EQ(40000u, histogram.count());
+  EXPECT_EQ(39999u, histogram.max());
+}
+
+#ifdef MGPP_SIGNALS_METRICS
+TEST(DispatcherMetrics, CountsPublishesAndTimesSlots) {
+  using mgpp::signals::EventConstPtr;
+
+  mgpp::signals::ResetDispatcherMetrics();
+  mgpp::signals::Subscribe(FAST_EVENT, [](const EventConstPtr &) {});
+  mgpp::signals::Subscribe(FAST_EVENT, [](const EventConstPtr &) {});
+  mgpp::signals::Subscribe(SLOW_EVENT, [](const EventConstPtr &) {
+    // Spin on the clock the slot is timed with, so it takes at least 2 ms
+    const std::chrono::steady_clock::time_point until =
+        std::chrono::steady_clock::now() + std::chrono::milliseconds(2);
+    while (std::chrono::steady_clock::now() < until) {
+    }
+  });
+
+  for (int i = 0; i < 10; ++i) {
+    mgpp::signals::Publish(
+        mgpp::signals::MakeEvent<mgpp::signals::Event>(FAST_EVENT));
+  }
+  mgpp::signals::Publish(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(SLOW_EVENT));
+  mgpp::signals::Publish(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(QUIET_EVENT));
+
+  const std::vector<mgpp::signals::IdMetrics> ids =
+      mgpp::signals::DispatcherIdMetrics();
+  ASSERT_EQ(3u, ids.size());
+  EXPECT_EQ(FAST_EVENT, ids[0].id);
+  EXPECT_EQ(10u, ids[0].publishes);
+  EXPECT_EQ(20u, ids[0].slot_calls);
+  EXPECT_EQ(2u, ids[0].max_fanout);
+  EXPECT_EQ(1u, ids[1].slot_calls);
+  EXPECT_EQ(QUIET_EVENT, ids[2].id);
+  EXPECT_EQ(1u, ids[2].publishes);
+  EXPECT_EQ(0u, ids[2].slot_calls);
+
+  // The slow subscriber comes first
+  const std::vector<mgpp::signals::SlotMetrics> slots =
+      mgpp::signals::DispatcherSlotMetrics();
+  ASSERT_EQ(3u, slots.size());
+  EXPECT_EQ(SLOW_EVENT, slots[0].id);
+  EXPECT_EQ(1u, slots[0].calls);
+  EXPECT_GE(slots[0].max_ns, 2000000u);
+  EXPECT_EQ(10u, slots[1].calls);
+
+  std::ostringstream dump;
+  mgpp::signals::DumpDispatcherMetrics(dump);
+  EXPECT_NE(std::string::npos, dump.str().find("id 8 slot 0: 1 calls"));
+
+  mgpp::signals::UnsubscribeAll();
+}
+
+TEST(DispatcherMetrics, SeparatePerDispatcher) {
+  using mgpp::signals::EventConstPtr;
+
+  mgpp::signals::ResetDispatcherMetrics();
+  mgpp::signals::Dispatcher dispatcher;
+  dispatcher.Subscribe(FAST_EVENT, [](const EventConstPtr &) {});
+  mgpp::signals::Subscribe(FAST_EVENT, [](const EventConstPtr &) {});
+  for (int i = 0; i < 3; ++i) {
+    dispatcher.Publish(
+        mgpp::signals::MakeEvent<mgpp::signals::Event>(FAST_EVENT));
+  }
+  mgpp::signals::Publish(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(FAST_EVENT));
+
+  // Same id, but each dispatcher only counts its own publishes and slots
+  const std::vector<mgpp::signals::IdMetrics> ids = dispatcher.id_metrics();
+  ASSERT_EQ(1u, ids.size());
+  EXPECT_EQ(3u, ids[0].publishes);
+  ASSERT_EQ(1u, dispatcher.slot_metrics().size());
+  EXPECT_EQ(3u, dispatcher.slot_metrics()[0].calls);
+
+  // The default dispatcher keeps the ids of earlier tests, reset to zero
+  for (const mgpp::signals::IdMetrics &id :
+       mgpp::signals::DispatcherIdMetrics()) {
+    EXPECT_EQ(id.id == FAST_EVENT ? 1u : 0u, id.publishes);
+  }
+  const std::vector<mgpp::signals::SlotMetrics> slots =
+      mgpp::signals::DispatcherSlotMetrics();
+  EXPECT_EQ(1u, slots.size());
+  for (const mgpp::signals::SlotMetrics &slot : slots) {
+    EXPECT_EQ(1u, slot.calls);
+  }
+
+  mgpp::signals::UnsubscribeAll();
+}
+
+TEST(DispatcherMetrics, ForgetsUnsubscribedSlots) {
+  using mgpp::signals::EventConstPtr;
+
+  mgpp::signals::ResetDispatcherMetrics();
+  for (int i = 0; i < 1000; ++i) {
+    const mgpp::signals::Connection connection =
+        mgpp::signals::Subscribe(FAST_EVENT, [](const EventConstPtr &) {});
+    mgpp::signals::Unsubscribe(FAST_EVENT, connection);
+  }
+  mgpp::signals::Subscribe(FAST_EVENT, [](const EventConstPtr &) {});
+
+  const std::vector<mgpp::signals::SlotMetrics> slots =
+      mgpp::signals::DispatcherSlotMetrics();
+  ASSERT_EQ(1u, slots.size());
+  EXPECT_EQ(FAST_EVENT, slots[0].id);
+
+  mgpp::signals::UnsubscribeAll();
+}
+#endif
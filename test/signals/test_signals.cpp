@@ -26,7 +26,12 @@
 
 #include <gtest/gtest.h>
 
+#include <atomic>
+#include <memory>
 #include <string>
+#include <thread>
+#include <utility>
+#include <vector>
 
 #include <mgpp/signals.hpp>
 
@@ -44,19 +49,19 @@ class IntEvent : public mgpp::signals::Event {
 class StringEvent : public mgpp::signals::Event {
  public:
   explicit StringEvent(std::string arg)
-      : mgpp::signals::Event(STRING_EVENT), arg_(arg) {}
+      : mgpp::signals::Event(STRING_EVENT), arg_(std::move(arg)) {}
   const std::string &arg() const { return arg_; }
 
  private:
   std::string arg_;
 };
 
-void IntCb(mgpp::signals::EventConstPtr event) {
+void IntCb(const mgpp::signals::EventConstPtr &event) {
   const IntEvent &int_evt = static_cast<const IntEvent &>(*event);
   EXPECT_EQ(int_evt.id(), int_evt.arg());
 }
 
-void StringCb(mgpp::signals::EventConstPtr event) {
+void StringCb(const mgpp::signals::EventConstPtr &event) {
   const StringEvent &str_evt = static_cast<const StringEvent &>(*event);
   EXPECT_EQ("foo", str_evt.arg());
 }
@@ -110,14 +115,71 @@ TEST_F(EventDispatcherTest, Publish) {
   mgpp::signals::Publish(str_evt);
 }
 
+TEST(Event, MakeEventForwardsArguments) {
+  // Move-only arguments reach the constructor
+  std::unique_ptr<int> value(new int(42));
+  auto evt = mgpp::signals::MakeEvent<
+      mgpp::signals::PayloadEvent<std::unique_ptr<int>>>(INT_EVENT,
+                                                         std::move(value));
+  EXPECT_EQ(INT_EVENT, evt->id());
+  EXPECT_EQ(42, *evt->payload());
+}
+
+TEST(Event, PayloadAdoptsBuffer) {
+  std::vector<char> buffer(4096, 'x');
+  const char *data = buffer.data();
+
+  auto evt =
+      mgpp::signals::MakeEvent<mgpp::signals::PayloadEvent<std::vector<char>>>(
+          STRING_EVENT, std::move(buffer));
+  EXPECT_EQ(data, evt->payload().data());
+  EXPECT_EQ(4096u, evt->payload().size());
+
+  // Lvalues are copied, leaving the caller's buffer alone
+  std::vector<char> kept(16, 'y');
+  auto copy =
+      mgpp::signals::MakeEvent<mgpp::signals::PayloadEvent<std::vector<char>>>(
+          STRING_EVENT, kept);
+  EXPECT_NE(kept.data(), copy->payload().data());
+  EXPECT_EQ(kept, copy->payload());
+}
+
+TEST(Event, PayloadConstructedInPlace) {
+  auto evt = mgpp::signals::MakeEvent<mgpp::signals::PayloadEvent<std::string>>(
+      STRING_EVENT, 3u, 'z');
+  EXPECT_EQ("zzz", evt->payload());
+}
+
+TEST(Event, StaticEventsAreShared) {
+  const mgpp::signals::EventConstPtr &a =
+      mgpp::signals::StaticEvent<INT_EVENT>();
+  EXPECT_EQ(INT_EVENT, a->id());
+  EXPECT_TRUE(a == mgpp::signals::StaticEvent<INT_EVENT>());
+  EXPECT_FALSE(a == mgpp::signals::StaticEvent<STRING_EVENT>());
+
+  // Copies and releases never allocate or free
+  const std::vector<mgpp::signals::PoolMetrics> before(
+      mgpp::signals::EventPoolMetrics());
+  {
+    std::vector<mgpp::signals::EventConstPtr> copies(1000, a);
+    mgpp::signals::Publish(copies.front());
+  }
+  const std::vector<mgpp::signals::PoolMetrics> after(
+      mgpp::signals::EventPoolMetrics());
+  for (std::size_t i = 0; i < before.size(); ++i) {
+    EXPECT_EQ(before[i].in_use, after[i].in_use);
+  }
+  EXPECT_EQ(INT_EVENT, mgpp::signals::StaticEvent<INT_EVENT>()->id());
+}
+
 class Foo {
  public:
-  void IntCb(mgpp::signals::EventConstPtr event) {
+  void IntCb(const mgpp::signals::EventConstPtr &event) {
     const IntEvent &int_evt = static_cast<const IntEvent &>(*event);
     EXPECT_EQ(int_evt.id(), int_evt.arg());
   }
 
-  void StringCb(mgpp::signals::EventConstPtr event) {
+  void StringCb(const mgpp::signals::EventConstPtr &event) {
     const StringEvent &str_evt = static_cast<const StringEvent &>(*event);
     EXPECT_EQ("foo", str_evt.arg());
   }
@@ -170,3 +232,152 @@ TEST_F(EventMemberDispatcherTest, Publish) {
       mgpp::signals::MakeEvent<StringEvent>("foo"));
   mgpp::signals::Publish(str_evt);
 }
+
+TEST(EventDispatcher, DenseAndSparseIds) {
+  const std::vector<int> ids = {0, 5, 1023, 1024, 100000, -7};
+
+  std::vector<int> delivered;
+  std::vector<mgpp::signals::Connection> conns;
+  for (int id : ids) {
+    conns.push_back(mgpp::signals::Subscribe(
+        id, [&delivered](const mgpp::signals::EventConstPtr &event) {
+          delivered.push_back(event->id());
+        }));
+  }
+
+  for (int id : ids) {
+    EXPECT_EQ(1, mgpp::signals::NumSlots(id));
+    mgpp::signals::Publish(mgpp::signals::MakeEvent<mgpp::signals::Event>(id));
+  }
+  EXPECT_EQ(ids, delivered);
+  EXPECT_EQ(0, mgpp::signals::NumSlots(6));
+  EXPECT_EQ(0, mgpp::signals::NumSlots(-8));
+
+  // Moving the dense range keeps every subscription
+  mgpp::signals::SetDenseIds(8);
+  delivered.clear();
+  for (int id : ids) {
+    mgpp::signals::Publish(mgpp::signals::MakeEvent<mgpp::signals::Event>(id));
+  }
+  EXPECT_EQ(ids, delivered);
+
+  for (std::size_t i = 0; i < ids.size(); ++i) {
+    mgpp::signals::Unsubscribe(ids[i], conns[i]);
+    EXPECT_EQ(0, mgpp::signals::NumSlots(ids[i]));
+  }
+  mgpp::signals::SetDenseIds(1024);
+}
+
+TEST(EventDispatcher, IndependentInstances) {
+  std::vector<int> first;
+  std::vector<int> second;
+  auto record = [](std::vector<int> *delivered) {
+    return [delivered](const mgpp::signals::EventConstPtr &event) {
+      delivered->push_back(event->id());
+    };
+  };
+
+  {
+    mgpp::signals::Dispatcher shard1;
+    mgpp::signals::Dispatcher shard2(16);
+    shard1.Subscribe(INT_EVENT, record(&first));
+    shard2.Subscribe(INT_EVENT, record(&second));
+    shard2.Subscribe(STRING_EVENT, record(&second));
+    EXPECT_EQ(1, shard1.NumSlots(INT_EVENT));
+    EXPECT_EQ(0, shard1.NumSlots(STRING_EVENT));
+    EXPECT_EQ(0, mgpp::signals::NumSlots(INT_EVENT));
+
+    shard1.Publish(mgpp::signals::MakeEvent<IntEvent>(INT_EVENT));
+    shard2.Publish(mgpp::signals::MakeEvent<StringEvent>("foo"));
+    mgpp::signals::Publish(mgpp::signals::MakeEvent<IntEvent>(INT_EVENT));
+    EXPECT_EQ(std::vector<int>({INT_EVENT}), first);
+    EXPECT_EQ(std::vector<int>({STRING_EVENT}), second);
+
+    shard2.UnsubscribeAll();
+    EXPECT_EQ(1, shard1.NumSlots(INT_EVENT));
+  }
+
+  // The default dispatcher is a dispatcher like any other
+  EXPECT_EQ(&mgpp::signals::Dispatcher::Instance(),
+            &mgpp::signals::Dispatcher::Instance());
+}
+
+TEST(EventDispatcherConcurrency, PublishWhileSubscribing) {
+  const int kPublishers = 4;
+  const int kPublishes = 20000;
+  const int kChurnIds = 16;
+
+  std::atomic<int> delivered(0);
+  mgpp::signals::Subscribe(
+      INT_EVENT, [&delivered](const mgpp::signals::EventConstPtr &event) {
+        (void)event;
+        delivered++;
+      });
+
+  // Keep connecting and disconnecting slots, both on the published id and on
+  // ids that get added to and removed from the dispatcher table.
+  std::atomic<bool> done(false);
+  std::thread churn([&done]() {
+    auto noop = [](const mgpp::signals::EventConstPtr &event) { (void)event; };
+    for (int i = 0; !done; ++i) {
+      const int id = (i % 2) ? INT_EVENT : 100 + i % kChurnIds;
+      mgpp::signals::Connection conn = mgpp::signals::Subscribe(id, noop);
+      mgpp::signals::Unsubscribe(id, conn);
+    }
+  });
+
+  std::vector<std::thread> publishers;
+  for (int i = 0; i < kPublishers; ++i) {
+    publishers.emplace_back([]() {
+      mgpp::signals::EventConstPtr int_evt(
+          mgpp::signals::MakeEvent<IntEvent>(INT_EVENT));
+      for (int j = 0; j < kPublishes; ++j) {
+        mgpp::signals::Publish(int_evt);
+        mgpp::signals::Publish(mgpp::signals::MakeEvent<mgpp::signals::Event>(
+            100 + j % kChurnIds));
+      }
+    });
+  }
+  for (auto &publisher : publishers) {
+    publisher.join();
+  }
+  done = true;
+  churn.join();
+
+  EXPECT_EQ(kPublishers * kPublishes, delivered);
+  EXPECT_EQ(1, mgpp::signals::NumSlots(INT_EVENT));
+
+  mgpp::signals::UnsubscribeAll();
+}
+
+TEST(EventDispatcherConcurrency, ManyPublishingThreads) {
+  const int kThreads = 300;
+
+  std::atomic<int> delivered(0);
+  mgpp::signals::Subscribe(
+      INT_EVENT, [&delivered](const mgpp::signals::EventConstPtr &event) {
+        (void)event;
+        delivered++;
+      });
+
+  // Keep every thread alive until all have published, so each one needs a
+  // reader record of its own
+  std::atomic<int> published(0);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kThreads; ++i) {
+    threads.emplace_back([&published]() {
+      mgpp::signals::Publish(mgpp::signals::MakeEvent<IntEvent>(INT_EVENT));
+      published++;
+      while (published < kThreads) {
+        std::this_thread::yield();
+      }
+    });
+  }
+  for (auto &thread : threads) {
+    thread.join();
+  }
+
+  EXPECT_EQ(kThreads, delivered);
+
+  mgpp::signals::UnsubscribeAll();
+}
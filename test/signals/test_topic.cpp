@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+#include <gtest/gtest.h>
+
+#include <stdexcept>
+#include <vector>
+
+#include <mgpp/signals.hpp>
+
+// Topics stay registered for the whole process, so every test uses ids and
+// topics of its own
+enum TopicTestEvent {
+  KITCHEN_TEMPERATURE = 100,
+  KITCHEN_HUMIDITY,
+  GARAGE_TEMPERATURE,
+  SENSOR,
+  GARAGE_DOOR = 200,
+  CELLAR_TEMPERATURE = 300,
+  GARDEN_TEMPERATURE
+};
+
+class TopicTest : public ::testing::Test {
+ protected:
+  static void SetUpTestCase() {
+    mgpp::signals::RegisterTopic(KITCHEN_TEMPERATURE,
+                                 "sensor/kitchen/temperature");
+    mgpp::signals::RegisterTopic(KITCHEN_HUMIDITY, "sensor/kitchen/humidity");
+    mgpp::signals::RegisterTopic(GARAGE_TEMPERATURE,
+                                 "sensor/garage/temperature");
+    mgpp::signals::RegisterTopic(SENSOR, "sensor");
+  }
+
+  void TearDown() override { mgpp::signals::UnsubscribeAll(); }
+
+  // Subscribe to `pattern`, recording the ids received in `received_`
+  mgpp::signals::TopicSubscription Record(const std::string &pattern) {
+    return mgpp::signals::SubscribeTopic(
+        pattern, [this](const mgpp::signals::EventConstPtr &event) {
+          received_.push_back(event->id());
+        });
+  }
+
+  void PublishAll() {
+    for (const int id : {KITCHEN_TEMPERATURE, KITCHEN_HUMIDITY,
+                         GARAGE_TEMPERATURE, SENSOR}) {
+      mgpp::signals::Publish(
+          mgpp::signals::MakeEvent<mgpp::signals::Event>(id));
+    }
+  }
+
+  std::vector<int> received_;
+};
+
+TEST_F(TopicTest, MatchesLevels) {
+  EXPECT_EQ(std::vector<int>({KITCHEN_TEMPERATURE}),
+            mgpp::signals::MatchTopic("sensor/kitchen/temperature"));
+  EXPECT_EQ(std::vector<int>({KITCHEN_TEMPERATURE, GARAGE_TEMPERATURE}),
+            mgpp::signals::MatchTopic("sensor/+/temperature"));
+  EXPECT_EQ(std::vector<int>({KITCHEN_TEMPERATURE, KITCHEN_HUMIDITY}),
+            mgpp::signals::MatchTopic("sensor/kitchen/+"));
+  EXPECT_EQ(std::vector<int>({KITCHEN_TEMPERATURE, KITCHEN_HUMIDITY,
+                              GARAGE_TEMPERATURE, SENSOR}),
+            mgpp::signals::MatchTopic("sensor/#"));
+  EXPECT_EQ(std::vector<int>({SENSOR}), mgpp::signals::MatchTopic("+"));
+  EXPECT_TRUE(mgpp::signals::MatchTopic("sensor/+").empty());
+  EXPECT_TRUE(mgpp::signals::MatchTopic("sensor/kitchen").empty());
+}
+
+TEST_F(TopicTest, WildcardSubscription) {
+  Record("sensor/+/temperature");
+  EXPECT_EQ(1, mgpp::signals::NumSlots(KITCHEN_TEMPERATURE));
+  EXPECT_EQ(0, mgpp::signals::NumSlots(KITCHEN_HUMIDITY));
+
+  PublishAll();
+  EXPECT_EQ(std::vector<int>({KITCHEN_TEMPERATURE, GARAGE_TEMPERATURE}),
+            received_);
+}
+
+TEST_F(TopicTest, OverlappingPatternsEachGetTheEvent) {
+  Record("sensor/#");
+  Record("sensor/kitchen/temperature");
+
+  PublishAll();
+  EXPECT_EQ(std::vector<int>({KITCHEN_TEMPERATURE, KITCHEN_TEMPERATURE,
+                              KITCHEN_HUMIDITY, GARAGE_TEMPERATURE, SENSOR}),
+            received_);
+}
+
+TEST_F(TopicTest, LaterTopicsJoinSubscriptions) {
+  Record("door/#");
+  mgpp::signals::RegisterTopic(GARAGE_DOOR, "door/garage");
+  mgpp::signals::RegisterTopic(GARAGE_DOOR, "door/garage");
+
+  mgpp::signals::Publish(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(GARAGE_DOOR));
+  EXPECT_EQ(std::vector<int>({GARAGE_DOOR}), received_);
+}
+
+TEST_F(TopicTest, Unsubscribe) {
+  const mgpp::signals::TopicSubscription subscription = Record("sensor/#");
+  EXPECT_TRUE(subscription.valid());
+  mgpp::signals::UnsubscribeTopic(subscription);
+  EXPECT_EQ(0, mgpp::signals::NumSlots(SENSOR));
+
+  PublishAll();
+  EXPECT_TRUE(received_.empty());
+
+  // The subscription is gone for topics registered later too
+  mgpp::signals::RegisterTopic(CELLAR_TEMPERATURE,
+                               "sensor/cellar/temperature");
+  EXPECT_EQ(0, mgpp::signals::NumSlots(CELLAR_TEMPERATURE));
+}
+
+TEST_F(TopicTest, UnsubscribeAllDropsPatterns) {
+  Record("sensor/+/temperature");
+  mgpp::signals::UnsubscribeAll();
+
+  mgpp::signals::RegisterTopic(GARDEN_TEMPERATURE,
+                               "sensor/garden/temperature");
+  EXPECT_EQ(0, mgpp::signals::NumSlots(GARDEN_TEMPERATURE));
+}
+
+TEST_F(TopicTest, InvalidTopicsAndPatterns) {
+  EXPECT_THROW(mgpp::signals::RegisterTopic(400, ""), std::invalid_argument);
+  EXPECT_THROW(mgpp::signals::RegisterTopic(400, "a//b"),
+               std::invalid_argument);
+  EXPECT_THROW(mgpp::signals::RegisterTopic(400, "a/+"),
+               std::invalid_argument);
+  EXPECT_THROW(mgpp::signals::RegisterTopic(SENSOR, "other"),
+               std::invalid_argument);
+  EXPECT_THROW(mgpp::signals::RegisterTopic(400, "sensor"),
+               std::invalid_argument);
+
+  EXPECT_THROW(mgpp::signals::MatchTopic("a/#/b"), std::invalid_argument);
+  EXPECT_THROW(mgpp::signals::MatchTopic("a/b+"), std::invalid_argument);
+  EXPECT_THROW(Record("a//b"), std::invalid_argument);
+}
+
+TEST(DispatcherTopics, SeparateFromDefaultDispatcher) {
+  mgpp::signals::Dispatcher dispatcher;
+  // The default dispatcher has these ids under other topics
+  dispatcher.RegisterTopic(KITCHEN_TEMPERATURE, "room/kitchen");
+  dispatcher.RegisterTopic(GARAGE_TEMPERATURE, "room/garage");
+  EXPECT_EQ(std::vector<int>({KITCHEN_TEMPERATURE, GARAGE_TEMPERATURE}),
+            dispatcher.MatchTopic("room/+"));
+  EXPECT_TRUE(mgpp::signals::MatchTopic("room/#").empty());
+  EXPECT_TRUE(dispatcher.MatchTopic("sensor/#").empty());
+
+  std::vector<int> received;
+  const mgpp::signals::TopicSubscription subscription =
+      dispatcher.SubscribeTopic(
+          "room/#", [&received](const mgpp::signals::EventConstPtr &event) {
+            received.push_back(event->id());
+          });
+  EXPECT_EQ(1, dispatcher.NumSlots(KITCHEN_TEMPERATURE));
+  EXPECT_EQ(0, mgpp::signals::NumSlots(KITCHEN_TEMPERATURE));
+
+  dispatcher.Publish(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(GARAGE_TEMPERATURE));
+  mgpp::signals::Publish(
+      mgpp::signals::MakeEvent<mgpp::signals::Event>(KITCHEN_TEMPERATURE));
+  EXPECT_EQ(std::vector<int>({GARAGE_TEMPERATURE}), received);
+
+  dispatcher.UnsubscribeTopic(subscription);
+  EXPECT_EQ(0, dispatcher.NumSlots(GARAGE_TEMPERATURE));
+}
@@ -0,0 +1,95 @@
+/*
+ * Copyright (c) 2018 Matt Gigli
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to
+ * deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+ * FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE
+ * SOFTWARE.
+ */
+
+// Print the records of a trace file written by mgpp::ao::TraceFile, one
+// per line and merged across threads in time order:
+//
+//   <us since first record> t<thread> <hsm> <record type> <state> [signal]
+//
+// Objects and states are printed as addresses, to be matched against the
+// symbols of the traced binary, e.g. with addr2line or nm.
+
+#include <algorithm>
+#include <cinttypes>
+#include <cstdio>
+#include <exception>
+#include <vector>
+
+#include <mgpp/ao/trace.hpp>
+
+namespace {
+
+const char *TypeName(const std::uint16_t type) {
+  switch (type) {
+    case mgpp::ao::TRACE_DISPATCH:
+      return "DISPATCH";
+    case mgpp::ao::TRACE_ENTRY:
+      return "ENTRY";
+    case mgpp::ao::TRACE_EXIT:
+      return "EXIT";
+    case mgpp::ao::TRACE_INIT:
+      return "INIT";
+    case mgpp::ao::TRACE_TRANSITION:
+      return "TRANSITION";
+  }
+  return "UNKNOWN";
+}
+
+}  // namespace
+
+int main(int argc, char **argv) {
+  if (argc != 2) {
+    std::fprintf(stderr, "usage: %s TRACE_FILE\n", argv[0]);
+    return 2;
+  }
+
+  std::vector<mgpp::ao::TraceRecord> records;
+  try {
+    records = mgpp::ao::ReadTrace(argv[1]);
+  } catch (const std::exception &e) {
+    std::fprintf(stderr, "%s\n", e.what());
+    return 1;
+  }
+
+  std::stable_sort(
+      records.begin(), records.end(),
+      [](const mgpp::ao::TraceRecord &a, const mgpp::ao::TraceRecord &b) {
+        return a.timestamp < b.timestamp;
+      });
+
+  const std::uint64_t start = records.empty() ? 0 : records[0].timestamp;
+  for (const mgpp::ao::TraceRecord &record : records) {
+    std::printf("%14.3f t%-3u 0x%-14" PRIx64 " %-10s 0x%" PRIx64,
+                static_cast<double>(record.timestamp - start) / 1000.0,
+                static_cast<unsigned>(record.thread), record.object,
+                TypeName(record.type), record.state);
+    if (record.signal >= 0) {
+      std::printf(" %" PRId32, record.signal);
+    }
+    std::printf("\n");
+  }
+  return 0;
+}